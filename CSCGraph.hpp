@@ -2,6 +2,7 @@
 #define CSCGRAPH_H
 
 #include <stdint.h>
+#include <climits>
 #include <cstdlib>
 #include <fstream>
 #include <cstring>
@@ -10,58 +11,105 @@
 #include <fcntl.h>
 #include <omp.h>
 #include "Helper.hpp"
+#include "RadixSort.hpp"
 
 #ifdef __INTEL_COMPILER
 // use avx intrinsics
 #include "immintrin.h"
 #include "zmmintrin.h"
+#elif defined(ISA_HAS_AVX2) || defined(ISA_HAS_AVX512)
+#include <immintrin.h>
 #endif
 
 using namespace std;
 
-template<class idxType, class valType>
+// SpMM kernels of the CSC graph used in counting
+#define SPMM_SPLIT 0
+#define SPMM_PB 1
+#define SPMM_TILED 2
+#define SPMM_COMPRESSED 3
+#define SPMM_PULL 4
+// push (CSC-Split) or pull chosen by the counting per batch width
+#define SPMM_AUTO 5
+
+// row ids of a column are sorted by std::sort below SORT_RADIX_LEN, 
+// by radix sort within a thread, and by all the threads from SORT_PARALLEL_LEN
+#define SORT_RADIX_LEN 256
+#define SORT_PARALLEL_LEN (1 << 16)
+
+// bytes of y covered by a bin of the propagation blocking SpMM
+#ifndef PB_BIN_BYTES
+#define PB_BIN_BYTES (1 << 18)
+#endif
+
+// bytes of x (and y) covered by the side of a square tile of SPMM_TILED
+#ifndef TILE_BYTES
+#define TILE_BYTES (1 << 18)
+#endif
+
+// leading tag of the binary format with explicit index widths, the older 
+// format of 32-bit ids and offsets starts with its (non-negative) edge num
+#define CSC_BIN_WIDE_TAG (-64)
+
+/**
+ * @brief idxType holds the vertex ids (and the rows of the entries), 
+ * offType the col offsets and the edge and nnz counts, 64-bit offsets 
+ * only cost 4 bytes per vertex over the 32-bit ones
+ */
+template<class idxType, class valType, class offType = int64_t>
 class CSCGraph
 {
     public:
 
         CSCGraph(): _isDirected(false), _isOneBased(false), _numEdges(-1), _numVertices(-1), _nnZ(-1), 
-        _edgeVal(nullptr), _indexRow(nullptr), _indexCol(nullptr), 
-        _degList(nullptr), _numsplits(0), _splitsRowIds(nullptr), _splitsColIds(nullptr), _splitsVals(nullptr) {}
+        _indexRow(nullptr), _indexCol(nullptr), 
+        _degList(nullptr), _numsplits(0), _splitsRowOffsets(nullptr), _splitsColIds(nullptr), _permutation(nullptr), 
+        _pbThds(0), _pbCols(0), _pbNumBins(0), _pbShift(0), _pbBins(nullptr), 
+        _tileCols(0), _tileShift(0), _numRowBlocks(0), _isRawReleased(false) {}
 
         ~CSCGraph () {
 
-            if (_edgeVal != nullptr)
-                free(_edgeVal);
-
             if (_indexRow != nullptr)
                 free(_indexRow);
 
             if (_indexCol != nullptr)
                 free(_indexCol);
 
-            if (_splitsRowIds != nullptr)
-                delete[] _splitsRowIds;
+            if (_splitsRowOffsets != nullptr)
+                delete[] _splitsRowOffsets;
 
             if (_splitsColIds != nullptr)
                 delete[] _splitsColIds; 
 
-            if (_splitsVals != nullptr)
-                delete[] _splitsVals; 
+            if (_permutation != nullptr)
+                free(_permutation);
+
+            if (_pbBins != nullptr)
+            {
+#ifdef __INTEL_COMPILER
+                _mm_free(_pbBins);
+#else
+                free(_pbBins);
+#endif
+            }
         }
 
-        valType* getEdgeVals(idxType colId) {return _edgeVal + _indexCol[colId]; }
         idxType* getRowIdx(idxType colId) {return _indexRow + _indexCol[colId]; }
         idxType getColLen(idxType colId) {return _indexCol[colId+1] - _indexCol[colId]; }
 
         idxType getNumVertices() {return  _numVertices;} 
-        idxType getNNZ() {return _indexCol[_numVertices]; }
+        offType getNNZ() {return _indexCol[_numVertices]; }
         idxType* getIndexRow() {return _indexRow;}
-        idxType* getIndexCol() {return _indexCol;}
-        valType* getNNZVal() {return _edgeVal;} 
+        offType* getIndexCol() {return _indexCol;}
 
         idxType* getDegList() {return _degList;}
 
-        void createFromEdgeListFile(idxType numVerts, idxType numEdges, 
+        // the new id of each input vertex if the graph is reordered, 
+        // stored with the binary format
+        void setPermutation(idxType* perm);
+        idxType* getPermutation() {return _permutation;}
+
+        void createFromEdgeListFile(idxType numVerts, offType numEdges, 
                 idxType* srcList, idxType* dstList, bool isBenchmark = false);       
 
         void splitCSC(idxType numsplits);
@@ -69,31 +117,135 @@ class CSCGraph
         double spmmSplitExp(valType* x, valType* y, idxType xColNum, idxType numThds);
         void spmmSplit(valType* x, valType* y, idxType xColNum, idxType numThds);
 
+        // propagation blocking SpMM, the rows of x are first written to the 
+        // bins of their destination rows by sequential writes, each bin is then 
+        // accumulated into its cache-sized range of y. The plan is built at the 
+        // first call (or by buildPropBlocking) for up to xColNum columns
+        void buildPropBlocking(idxType numThds, idxType xColNum);
+        void spmmPB(valType* x, valType* y, idxType xColNum, idxType numThds);
+
+        // SpMM on square tiles of the matrix, the tiles of a row block are 
+        // visited by column blocks so that the y tile stays in cache and each
+        // x tile is read once per row block, entries are kept as 16-bit offsets 
+        // within their tile. Built at the first call or by buildTiles
+        void buildTiles(idxType xColNum);
+        void spmmTiled(valType* x, valType* y, idxType xColNum, idxType numThds);
+
+        // the sorted row ids of each column as variable-byte deltas without
+        // values, the kernels pull the neighbours of each vertex of the 
+        // symmetric matrix. Releasing the raw arrays leaves only the 
+        // compressed kernels, the degrees and the col index usable
+        void compressAdjacency(bool releaseRaw = false);
+        void spmvCompressed(valType* x, valType* y, idxType numThds);
+        void spmmCompressed(valType* x, valType* y, idxType xColNum, idxType numThds);
+
+        // row-parallel SpMM pulling the neighbours of each vertex from the 
+        // raw arrays, column i of the symmetric matrix is row i, so the CSC 
+        // layout serves as CSR without a transpose and y has no write conflicts
+        void spmvPull(valType* x, valType* y, idxType numThds);
+        void spmmPull(valType* x, valType* y, idxType xColNum, idxType numThds);
+
+        // y += A*x by one of the SPMM_ kernels, the SpMV is CSC-Split 
+        // unless compressed or pulled, SPMM_AUTO runs CSC-Split
+        void spmm(valType* x, valType* y, idxType xColNum, idxType numThds, int backend);
+        void spmv(valType* x, valType* y, idxType numThds, int backend);
+
+        // graphs beyond 32-bit offsets are stored with a header of the index 
+        // widths, returns false if the widths of the file do not fit idxType 
+        // and offType
         void serialize(ofstream& outputFile);
-        void deserialize(int inputFile);
+        bool deserialize(int inputFile);
 
     private:
         /* data */
 
+        void sortSegments(idxType* rows);
+        static bool readFull(int inputFile, char* buf, int64_t bytes);
+
+        // kernels of the rows of a split for each ISA, picked by utility::cpuISA(),
+        // the vector ones take int32 ids and float values
+        static void spmvSplitRows(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y);
+        static void spmmSplitRows(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y, idxType xColNum);
+        // full batches of a width known at compile time (8, 16, 32 or 64 columns), 
+        // the y row of a width is kept in registers without tail masks
+        template<int W> void spmmSplitFixed(valType* x, valType* y, idxType numThds, int isa);
+        template<int W> static void spmmSplitRowsFixed(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y);
+#ifdef ISA_HAS_AVX2
+        template<int W> ISA_TARGET_AVX2 static void spmmSplitRowsFixedAVX2(const offType* offsets, const idxType* colIds, 
+                idxType rows, const valType* x, valType* y);
+#endif
+#ifdef ISA_HAS_AVX512
+        template<int W> ISA_TARGET_AVX512 static void spmmSplitRowsFixedAVX512(const offType* offsets, const idxType* colIds, 
+                idxType rows, const valType* x, valType* y);
+#endif
+#ifdef ISA_HAS_AVX2
+        ISA_TARGET_AVX2 static void spmvSplitRowsAVX2(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y);
+        ISA_TARGET_AVX2 static void spmmSplitRowsAVX2(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y, idxType xColNum);
+#endif
+#ifdef ISA_HAS_AVX512
+        ISA_TARGET_AVX512 static void spmvSplitRowsAVX512(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y);
+        ISA_TARGET_AVX512 static void spmmSplitRowsAVX512(const offType* offsets, const idxType* colIds, idxType rows, 
+                const valType* x, valType* y, idxType xColNum);
+#endif
+
         bool _isDirected;
         bool _isOneBased;
-        idxType _numEdges;
+        offType _numEdges;
         idxType _numVertices;
-        idxType _nnZ;
-        valType* _edgeVal;
+        offType _nnZ;
+        // pattern only, all the entries of the adjacency are 1
         idxType* _indexRow;
-        idxType* _indexCol;
+        offType* _indexCol;
         idxType* _degList;
         idxType _numsplits;
 
-        std::vector<idxType>* _splitsRowIds;
+        // split s owns the rows _splitsRowStarts[s] to _splitsRowStarts[s+1] 
+        // as a local CSR, the sorted col ids of its local row r are 
+        // _splitsColIds[s][_splitsRowOffsets[s][r]] to [_splitsRowOffsets[s][r+1]]
+        std::vector<idxType> _splitsRowStarts;
+        std::vector<offType>* _splitsRowOffsets;
         std::vector<idxType>* _splitsColIds;
-        std::vector<valType>* _splitsVals;
+
+        idxType* _permutation;
+
+        // propagation blocking plan, bins of 1 << _pbShift rows, 
+        // the entries of bin b from thread t start at _pbOffsets[b*_pbThds+t]
+        idxType _pbThds;
+        idxType _pbCols;
+        idxType _pbNumBins;
+        int _pbShift;
+        std::vector<idxType> _pbColStarts;
+        std::vector<int64_t> _pbOffsets;
+        std::vector<idxType> _pbRows;
+        // payloads of xColNum values in the order of _pbRows
+        valType* _pbBins;
+
+        // tiles of 1 << _tileShift rows and columns, the tiles of row block rb
+        // are _rbTileStarts[rb] to _rbTileStarts[rb+1], sorted by column block
+        idxType _tileCols;
+        int _tileShift;
+        idxType _numRowBlocks;
+        std::vector<idxType> _rbTileStarts;
+        std::vector<idxType> _tileColBlocks;
+        std::vector<offType> _tileEntryStarts;
+        std::vector<uint16_t> _tileEntryRows;
+        std::vector<uint16_t> _tileEntryCols;
+
+        // bytes of column i are _compAdj[_compOffsets[i]] to _compAdj[_compOffsets[i+1]]
+        std::vector<int64_t> _compOffsets;
+        std::vector<uint8_t> _compAdj;
+        bool _isRawReleased;
 
 };
 
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::createFromEdgeListFile(idxType numVerts, idxType numEdges, idxType* srcList, idxType* dstList, bool isBenchmark) 
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::createFromEdgeListFile(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList, bool isBenchmark) 
 {
     _numEdges = numEdges;
     _numVertices = numVerts;
@@ -107,7 +259,7 @@ void CSCGraph<idxType, valType>::createFromEdgeListFile(idxType numVerts, idxTyp
 
     // build the degree list
 #pragma omp parallel for
-    for(idxType i = 0; i< _numEdges; i++)
+    for(offType i = 0; i< _numEdges; i++)
     {
         idxType srcId = srcList[i];
         idxType dstId = dstList[i];
@@ -125,39 +277,28 @@ void CSCGraph<idxType, valType>::createFromEdgeListFile(idxType numVerts, idxTyp
 
     // calculate the col index of CSC (offset)
     // size numVerts + 1
-    _indexCol = (idxType*)malloc((_numVertices+1)*sizeof(idxType));
+    _indexCol = (offType*)malloc((_numVertices+1)*sizeof(offType));
     _indexCol[0] = 0;
     for(idxType i=1; i<= _numVertices;i++)
         _indexCol[i] = _indexCol[i-1] + _degList[i-1]; 
 
-    // create the row index and val 
+    // create the row index 
     _nnZ = _indexCol[_numVertices];
 
     _indexRow = (idxType*)malloc(_indexCol[_numVertices]*sizeof(idxType));
     std::vector<idxType> indexRowVec(_indexCol[_numVertices]);
 
-    _edgeVal = (valType*)malloc(_indexCol[_numVertices]*sizeof(valType));
-
-#pragma omp parallel for num_threads(omp_get_max_threads())
-    for (int i = 0; i < _indexCol[_numVertices]; ++i) {
-        _edgeVal[i] = 0;
-    }
-
-    for(idxType i = 0; i< _numEdges; i++)
+    for(offType i = 0; i< _numEdges; i++)
     {
 
         idxType srcId = srcList[i];
         idxType dstId = dstList[i];
 
-        indexRowVec[_indexCol[dstId]] = srcId;
-        _edgeVal[(_indexCol[dstId])++] = 1.0;
+        indexRowVec[(_indexCol[dstId])++] = srcId;
 
         // non-directed graph
         if (!_isDirected)
-        {
-            indexRowVec[_indexCol[srcId]] = dstId;
-            _edgeVal[(_indexCol[srcId])++] = 1.0;
-        }
+            indexRowVec[(_indexCol[srcId])++] = dstId;
     }
 
     // recover the indexRow 
@@ -166,49 +307,132 @@ void CSCGraph<idxType, valType>::createFromEdgeListFile(idxType numVerts, idxTyp
         _indexCol[i] -= _degList[i];
 
     // sort the row id for each col
-    // no need to sort the val in adjacency matrix
-#pragma omp parallel for
+    sortSegments(indexRowVec.data());
+
+    std::copy(indexRowVec.begin(), indexRowVec.end(), _indexRow);
+}
+
+/**
+ * @brief sort the row ids of every column, the load of a hub column 
+ * is split over the threads instead of waiting on a single one
+ *
+ * @param rows
+ */
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::sortSegments(idxType* rows)
+{/*{{{*/
+
+    int numThds = omp_get_max_threads();
+
+    int idBits = 1;
+    while ((((int64_t)1) << idBits) < _numVertices)
+        idBits++;
+
+    std::vector<idxType> hubCols;
+    idxType maxHubLen = 0;
     for (idxType i = 0; i < _numVertices; ++i) {
+        if (_degList[i] >= SORT_PARALLEL_LEN)
+        {
+            hubCols.push_back(i);
+            maxHubLen = std::max(maxHubLen, _degList[i]);
+        }
+    }
+
+#pragma omp parallel num_threads(numThds)
+    {
+        std::vector<idxType> buf;
 
-        // is this thread safe ?
-        std::sort(indexRowVec.begin()+_indexCol[i], indexRowVec.begin()+_indexCol[i+1]);
+#pragma omp for schedule(dynamic, 256)
+        for (idxType i = 0; i < _numVertices; ++i) 
+        {
+            idxType len = _indexCol[i+1] - _indexCol[i];
+            if (len >= SORT_PARALLEL_LEN)
+                continue;
+
+            if (len >= SORT_RADIX_LEN)
+            {
+                buf.resize(len);
+                radixSort(rows + _indexCol[i], buf.data(), len, idBits, 1);
+            }
+            else
+                std::sort(rows + _indexCol[i], rows + _indexCol[i+1]);
+        }
     }
 
-    std::copy(indexRowVec.begin(), indexRowVec.end(), _indexRow);
+    if (hubCols.size() > 0)
+    {
+        std::vector<idxType> buf(maxHubLen);
+        for (idxType h = 0; h < hubCols.size(); ++h) {
+            idxType i = hubCols[h];
+            radixSort(rows + _indexCol[i], buf.data(), _indexCol[i+1] - _indexCol[i], idBits, numThds);
+        }
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::setPermutation(idxType* perm)
+{
+    if (_permutation == nullptr)
+        _permutation = (idxType*) malloc(_numVertices*sizeof(idxType));
+
+    std::memcpy(_permutation, perm, _numVertices*sizeof(idxType));
 }
 
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::splitCSC(idxType numsplits)
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::splitCSC(idxType numsplits)
 {
     double splitt0 = utility::timer();
     std::cout << "splitCSCStart: " << splitt0 << std::endl;
     _numsplits = numsplits;
-    if (_splitsRowIds != nullptr)
-        delete[] _splitsRowIds;
+    if (_splitsRowOffsets != nullptr)
+        delete[] _splitsRowOffsets;
 
     if (_splitsColIds != nullptr)
         delete[] _splitsColIds;
 
-    if (_splitsVals != nullptr)
-        delete[] _splitsVals;
-
-    _splitsRowIds = new std::vector<idxType>[_numsplits];
+    _splitsRowOffsets = new std::vector<offType>[_numsplits];
     _splitsColIds = new std::vector<idxType>[_numsplits];
-    _splitsVals = new std::vector<valType>[_numsplits];
 
-    idxType perpiece = _numVertices / _numsplits;
+    idxType perpiece = std::max(_numVertices / _numsplits, (idxType)1);
+    _splitsRowStarts.resize(_numsplits + 1);
+    for (idxType s = 0; s < _numsplits; ++s) 
+        _splitsRowStarts[s] = std::min(s*perpiece, _numVertices);
+
+    _splitsRowStarts[_numsplits] = _numVertices;
 
     std::cout << "In splitCSCStart - Before loop: " << utility::timer() << std::endl; 
-    for (idxType i=0; i < _numVertices; ++i)
+
+    // entries of each row
+    std::vector<offType> cursor(_numVertices, 0);
+    for (offType j = 0; j < _nnZ; ++j) 
+        cursor[_indexRow[j]]++;
+
+#pragma omp parallel for schedule(dynamic) num_threads(omp_get_max_threads())
+    for (idxType s = 0; s < _numsplits; ++s) 
     {
-        for (idxType j = _indexCol[i]; j < _indexCol[i+1]; ++j)
+        idxType rowStart = _splitsRowStarts[s];
+        idxType localRows = _splitsRowStarts[s+1] - rowStart;
+        std::vector<offType>& localOffsets = _splitsRowOffsets[s];
+
+        localOffsets.resize(localRows + 1);
+        localOffsets[0] = 0;
+        for (idxType r = 0; r < localRows; ++r) {
+            localOffsets[r+1] = localOffsets[r] + cursor[rowStart + r];
+            cursor[rowStart + r] = localOffsets[r];
+        }
+
+        _splitsColIds[s].resize(localOffsets[localRows]);
+    }
+
+    // columns are visited in order, so the col ids of a row are sorted
+    for (idxType i = 0; i < _numVertices; ++i)
+    {
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j)
         {
-            // already sorted
             idxType rowid = _indexRow[j];
             idxType owner = std::min(rowid / perpiece, (_numsplits-1));
-            _splitsColIds[owner].push_back(i);
-            _splitsRowIds[owner].push_back(rowid);
-            _splitsVals[owner].push_back(_edgeVal[j]);
+            _splitsColIds[owner][cursor[rowid]++] = i;
         }
     }
     double splitt1 = utility::timer();
@@ -216,103 +440,845 @@ void CSCGraph<idxType, valType>::splitCSC(idxType numsplits)
     std::cout << "splitCSC Time cost (s): " << splitt1 - splitt0 << std::endl;
 }
 
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::spmvNaiveSplit(valType* x, valType* y, idxType numThds)
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmvNaiveSplit(valType* x, valType* y, idxType numThds)
 {
-    // split CSC spmv
+    // the vector kernels gather float x by int32 ids
+    int isa = (sizeof(idxType) == 4 && sizeof(valType) == 4) ? utility::cpuISA() : ISA_SCALAR;
+
+    // split CSC spmv, each split owns its rows of y
 #pragma omp parallel for num_threads(numThds) 
     for (idxType s = 0; s < _numsplits; ++s) {
 
-        std::vector<idxType>* localRowIds = &(_splitsRowIds[s]);
-        std::vector<idxType>* localColIds = &(_splitsColIds[s]);
-        std::vector<valType>* localVals = &(_splitsVals[s]);
-        idxType localSize = localRowIds->size();
+        const offType* localOffsets = _splitsRowOffsets[s].data();
+        const idxType* localColIds = _splitsColIds[s].data();
+        idxType rowStart = _splitsRowStarts[s];
+        idxType localRows = _splitsRowStarts[s+1] - rowStart;
 
-// here the usage of simd will cause write conflict on rowid
-        for (idxType j = 0; j < localSize; ++j) {
-            idxType colid = (*localColIds)[j];
-            idxType rowid = (*localRowIds)[j];
-            valType val = (*localVals)[j];
-            y[rowid] += (val*x[colid]);
+#ifdef ISA_HAS_AVX512
+        if (isa == ISA_AVX512)
+        {
+            spmvSplitRowsAVX512(localOffsets, localColIds, localRows, x, y + rowStart);
+            continue;
+        }
+#endif
+#ifdef ISA_HAS_AVX2
+        if (isa == ISA_AVX2)
+        {
+            spmvSplitRowsAVX2(localOffsets, localColIds, localRows, x, y + rowStart);
+            continue;
         }
+#endif
+        spmvSplitRows(localOffsets, localColIds, localRows, x, y + rowStart);
     }
 }
 
 // sparse matrix dense matrix (multiple dense vectors) 
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::spmmSplit(valType* x, valType* y, idxType xColNum, idxType numThds)
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmSplit(valType* x, valType* y, idxType xColNum, idxType numThds)
 {
+    int isa = (sizeof(valType) == 4) ? utility::cpuISA() : ISA_SCALAR;
+
+    // the widths of the full batches, the remainder batch takes the general kernels
+    switch (xColNum)
+    {
+        case 8: spmmSplitFixed<8>(x, y, numThds, isa); return;
+        case 16: spmmSplitFixed<16>(x, y, numThds, isa); return;
+        case 32: spmmSplitFixed<32>(x, y, numThds, isa); return;
+        case 64: spmmSplitFixed<64>(x, y, numThds, isa); return;
+        default: break;
+    }
+
     // doing the computation
 #pragma omp parallel for num_threads(numThds) 
     for (idxType s = 0; s < _numsplits; ++s) {
 
-        std::vector<idxType>* localRowIds = &(_splitsRowIds[s]);
-        std::vector<idxType>* localColIds = &(_splitsColIds[s]);
-        // std::vector<valType>* localVals = &(_splitsVals[s]);
-        idxType localSize = localRowIds->size();
+        const offType* localOffsets = _splitsRowOffsets[s].data();
+        const idxType* localColIds = _splitsColIds[s].data();
+        idxType rowStart = _splitsRowStarts[s];
+        idxType localRows = _splitsRowStarts[s+1] - rowStart;
+        valType* localY = y + ((int64_t)rowStart)*xColNum;
 
-        for (idxType j = 0; j < localSize; ++j) 
+#ifdef ISA_HAS_AVX512
+        if (isa == ISA_AVX512)
+        {
+            spmmSplitRowsAVX512(localOffsets, localColIds, localRows, x, localY, xColNum);
+            continue;
+        }
+#endif
+#ifdef ISA_HAS_AVX2
+        if (isa == ISA_AVX2)
         {
-            idxType colid = (*localColIds)[j];
-            idxType rowid = (*localRowIds)[j];
-            // valType val = (*localVals)[j];
+            spmmSplitRowsAVX2(localOffsets, localColIds, localRows, x, localY, xColNum);
+            continue;
+        }
+#endif
+        spmmSplitRows(localOffsets, localColIds, localRows, x, localY, xColNum);
+    }
 
-            valType* readBufPtr = x + colid*xColNum;
-            valType* writeBufPtr = y + rowid*xColNum;
+}
 
-#ifdef __INTEL_COMPILER
-        __assume_aligned(readBufPtr, 64);
-        __assume_aligned(writeBufPtr, 64);
-#else
-        __builtin_assume_aligned(readBufPtr, 64);
-        __builtin_assume_aligned(writeBufPtr, 64);
+template<class idxType, class valType, class offType>
+template<int W>
+void CSCGraph<idxType, valType, offType>::spmmSplitFixed(valType* x, valType* y, idxType numThds, int isa)
+{
+#pragma omp parallel for num_threads(numThds) 
+    for (idxType s = 0; s < _numsplits; ++s) {
+
+        const offType* localOffsets = _splitsRowOffsets[s].data();
+        const idxType* localColIds = _splitsColIds[s].data();
+        idxType rowStart = _splitsRowStarts[s];
+        idxType localRows = _splitsRowStarts[s+1] - rowStart;
+        valType* localY = y + ((int64_t)rowStart)*W;
+
+#ifdef ISA_HAS_AVX512
+        if (isa == ISA_AVX512 && W % 16 == 0)
+        {
+            spmmSplitRowsFixedAVX512<W>(localOffsets, localColIds, localRows, x, localY);
+            continue;
+        }
+#endif
+#ifdef ISA_HAS_AVX2
+        if (isa >= ISA_AVX2)
+        {
+            spmmSplitRowsFixedAVX2<W>(localOffsets, localColIds, localRows, x, localY);
+            continue;
+        }
 #endif
+        spmmSplitRowsFixed<W>(localOffsets, localColIds, localRows, x, localY);
+    }
+}
 
-#ifdef __AVX512F__ 
-            // unrolled by 16 float
-            int n16 = xColNum & ~(16-1); 
-            __m512 tmpzero = _mm512_set1_ps (0);
-            __mmask16 mask = (1 << (xColNum - n16)) - 1;
+template<class idxType, class valType, class offType>
+template<int W>
+void CSCGraph<idxType, valType, offType>::spmmSplitRowsFixed(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y)
+{
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        valType* writeBufPtr = y + ((int64_t)r)*W;
 
-            __m512 vecX;
-            __m512 vecY;
-            __m512 vecBuf;
+        // constant trip counts, unrolled and vectorized by the compiler, up 
+        // to 16 columns the row is accumulated locally to stay in registers
+        if (W <= 16)
+        {
+            valType acc[W];
+            for (int k = 0; k < W; ++k) 
+                acc[k] = writeBufPtr[k];
 
-            for (int k = 0; k < n16; k+=16)
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
             {
-                vecX = _mm512_load_ps (&(readBufPtr[k]));
-                vecY = _mm512_load_ps (&(writeBufPtr[k]));
-                vecBuf = _mm512_add_ps(vecX, vecY);
-                _mm512_store_ps(&(writeBufPtr[k]), vecBuf);
+                const valType* readBufPtr = x + ((int64_t)colIds[j])*W;
+                for (int k = 0; k < W; ++k) 
+                    acc[k] += readBufPtr[k]; 
             }
 
-            if (n16 < xColNum)
+            for (int k = 0; k < W; ++k) 
+                writeBufPtr[k] = acc[k];
+        }
+        else
+        {
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
             {
-                vecX = _mm512_mask_load_ps(tmpzero, mask, &(readBufPtr[n16]));
-                vecY = _mm512_mask_load_ps(tmpzero, mask, &(writeBufPtr[n16]));
-                vecBuf = _mm512_add_ps(vecX, vecY);
-                _mm512_mask_store_ps(&(writeBufPtr[n16]), mask, vecBuf);
+                const valType* readBufPtr = x + ((int64_t)colIds[j])*W;
+                for (int k = 0; k < W; ++k) 
+                    writeBufPtr[k] += readBufPtr[k]; 
             }
+        }
+    }
+}
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmvSplitRows(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y)
+{
+    // the gathers of a row reduce in registers, no store conflicts
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        valType sum = 0;
+        for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+            sum += x[colIds[j]];
+
+        y[r] += sum;
+    }
+}
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmSplitRows(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y, idxType xColNum)
+{
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        valType* writeBufPtr = y + ((int64_t)r)*xColNum;
+
+        // compiler auto vectorization, the row of y is written by this split only
+        for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+        {
+            const valType* readBufPtr = x + ((int64_t)colIds[j])*xColNum;
+            for (int k = 0; k < xColNum; ++k) 
+                writeBufPtr[k] += readBufPtr[k]; 
+        }
+    }
+}
+
+#ifdef ISA_HAS_AVX2
+template<class idxType, class valType, class offType>
+template<int W>
+ISA_TARGET_AVX2 void CSCGraph<idxType, valType, offType>::spmmSplitRowsFixedAVX2(const offType* offsets, const idxType* colIds, 
+        idxType rows, const valType* x, valType* y)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        float* writeBufPtr = yf + ((int64_t)r)*W;
+
+        // W/8 registers hold the y row over all the gathered rows of x
+        __m256 vecY[W/8];
+        for (int v = 0; v < W/8; ++v)
+            vecY[v] = _mm256_loadu_ps (&(writeBufPtr[8*v]));
+
+        for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+        {
+            const float* readBufPtr = xf + ((int64_t)colIds[j])*W;
+            for (int v = 0; v < W/8; ++v)
+                vecY[v] = _mm256_add_ps(vecY[v], _mm256_loadu_ps (&(readBufPtr[8*v])));
+        }
+
+        for (int v = 0; v < W/8; ++v)
+            _mm256_storeu_ps(&(writeBufPtr[8*v]), vecY[v]);
+    }
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+ISA_TARGET_AVX2 void CSCGraph<idxType, valType, offType>::spmvSplitRowsAVX2(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        // 8 gathers per step, the rest of the row added one by one
+        offType j = offsets[r];
+        __m256 vecSum = _mm256_setzero_ps();
+        for (; j + 8 <= offsets[r+1]; j += 8)
+        {
+            __m256i vecIdx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colIds + j));
+            vecSum = _mm256_add_ps(vecSum, _mm256_i32gather_ps(xf, vecIdx, 4));
+        }
+
+        __m128 vecHalf = _mm_add_ps(_mm256_castps256_ps128(vecSum), _mm256_extractf128_ps(vecSum, 1));
+        vecHalf = _mm_add_ps(vecHalf, _mm_movehl_ps(vecHalf, vecHalf));
+        vecHalf = _mm_add_ss(vecHalf, _mm_shuffle_ps(vecHalf, vecHalf, 1));
+        float sum = _mm_cvtss_f32(vecHalf);
+
+        for (; j < offsets[r+1]; ++j) 
+            sum += xf[colIds[j]];
+
+        yf[r] += sum;
+    }
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+ISA_TARGET_AVX2 void CSCGraph<idxType, valType, offType>::spmmSplitRowsAVX2(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y, idxType xColNum)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+
+    // unrolled by 8 float, the tail columns by a mask
+    int n8 = xColNum & ~(8-1); 
+    int mask_integer[8]={0,0,0,0,0,0,0,0};
+    for (int i=0;i<(xColNum - n8); i++)
+        mask_integer[i] = -1;
+
+    __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask_integer));
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        float* writeBufPtr = yf + ((int64_t)r)*xColNum;
+
+        // the row of y stays in registers over the rows of x it gathers
+        for (int k = 0; k < n8; k+=8)
+        {
+            __m256 vecY = _mm256_loadu_ps (&(writeBufPtr[k]));
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+                vecY = _mm256_add_ps(vecY, _mm256_loadu_ps (&(xf[((int64_t)colIds[j])*xColNum + k])));
+
+            _mm256_storeu_ps(&(writeBufPtr[k]), vecY);
+        }
+
+        if (n8 < xColNum)
+        {
+            __m256 vecY = _mm256_maskload_ps(&(writeBufPtr[n8]), mask);
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+                vecY = _mm256_add_ps(vecY, _mm256_maskload_ps(&(xf[((int64_t)colIds[j])*xColNum + n8]), mask));
+
+            _mm256_maskstore_ps(&(writeBufPtr[n8]), mask, vecY);
+        }
+    }
+}/*}}}*/
+#endif
+
+#ifdef ISA_HAS_AVX512
+template<class idxType, class valType, class offType>
+template<int W>
+ISA_TARGET_AVX512 void CSCGraph<idxType, valType, offType>::spmmSplitRowsFixedAVX512(const offType* offsets, const idxType* colIds, 
+        idxType rows, const valType* x, valType* y)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+    // W is a multiple of 16 on this path, NV only keeps the array non-empty otherwise
+    const int NV = (W >= 16) ? W/16 : 1;
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        float* writeBufPtr = yf + ((int64_t)r)*W;
+
+        __m512 vecY[NV];
+        for (int v = 0; v < NV; ++v)
+            vecY[v] = _mm512_loadu_ps (&(writeBufPtr[16*v]));
+
+        for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+        {
+            const float* readBufPtr = xf + ((int64_t)colIds[j])*W;
+            for (int v = 0; v < NV; ++v)
+                vecY[v] = _mm512_add_ps(vecY[v], _mm512_loadu_ps (&(readBufPtr[16*v])));
+        }
+
+        for (int v = 0; v < NV; ++v)
+            _mm512_storeu_ps(&(writeBufPtr[16*v]), vecY[v]);
+    }
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+ISA_TARGET_AVX512 void CSCGraph<idxType, valType, offType>::spmvSplitRowsAVX512(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+    __m512 tmpzero = _mm512_set1_ps (0);
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        // 16 gathers per step, the tail of the row by a mask
+        offType j = offsets[r];
+        __m512 vecSum = tmpzero;
+        for (; j + 16 <= offsets[r+1]; j += 16)
+        {
+            __m512i vecIdx = _mm512_loadu_si512(colIds + j);
+            vecSum = _mm512_add_ps(vecSum, _mm512_mask_i32gather_ps(tmpzero, 0xFFFF, vecIdx, xf, 4));
+        }
+
+        if (j < offsets[r+1])
+        {
+            __mmask16 mask = (1 << (offsets[r+1] - j)) - 1;
+            __m512i vecIdx = _mm512_maskz_loadu_epi32(mask, colIds + j);
+            vecSum = _mm512_add_ps(vecSum, _mm512_mask_i32gather_ps(tmpzero, mask, vecIdx, xf, 4));
+        }
+
+        // the merge-masked extracts leave no register undefined, unlike 
+        // _mm512_reduce_add_ps and the unmasked gather (-Wmaybe-uninitialized)
+        __m512d vecSumPd = _mm512_castps_pd(vecSum);
+        __m256 vecHalf = _mm256_add_ps(
+                _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vecSumPd, 0)), 
+                _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vecSumPd, 1)));
+        __m128 vecQuarter = _mm_add_ps(_mm256_castps256_ps128(vecHalf), _mm256_extractf128_ps(vecHalf, 1));
+        vecQuarter = _mm_add_ps(vecQuarter, _mm_movehl_ps(vecQuarter, vecQuarter));
+        vecQuarter = _mm_add_ss(vecQuarter, _mm_shuffle_ps(vecQuarter, vecQuarter, 1));
+
+        yf[r] += _mm_cvtss_f32(vecQuarter);
+    }
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+ISA_TARGET_AVX512 void CSCGraph<idxType, valType, offType>::spmmSplitRowsAVX512(const offType* offsets, const idxType* colIds, idxType rows, 
+        const valType* x, valType* y, idxType xColNum)
+{/*{{{*/
+    const float* xf = reinterpret_cast<const float*>(x);
+    float* yf = reinterpret_cast<float*>(y);
+
+    int n16 = xColNum & ~(16-1); 
+    __m512 tmpzero = _mm512_set1_ps (0);
+    __mmask16 mask = (1 << (xColNum - n16)) - 1;
+
+    for (idxType r = 0; r < rows; ++r) 
+    {
+        float* writeBufPtr = yf + ((int64_t)r)*xColNum;
+
+        // the row of y stays in registers over the rows of x it gathers
+        for (int k = 0; k < n16; k+=16)
+        {
+            __m512 vecY = _mm512_loadu_ps (&(writeBufPtr[k]));
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+                vecY = _mm512_add_ps(vecY, _mm512_loadu_ps (&(xf[((int64_t)colIds[j])*xColNum + k])));
+
+            _mm512_storeu_ps(&(writeBufPtr[k]), vecY);
+        }
+
+        if (n16 < xColNum)
+        {
+            __m512 vecY = _mm512_mask_loadu_ps(tmpzero, mask, &(writeBufPtr[n16]));
+            for (offType j = offsets[r]; j < offsets[r+1]; ++j) 
+                vecY = _mm512_add_ps(vecY, _mm512_mask_loadu_ps(tmpzero, mask, &(xf[((int64_t)colIds[j])*xColNum + n16])));
+
+            _mm512_mask_storeu_ps(&(writeBufPtr[n16]), mask, vecY);
+        }
+    }
+}/*}}}*/
+#endif
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::buildPropBlocking(idxType numThds, idxType xColNum)
+{/*{{{*/
+
+#ifdef VERBOSE
+    double startTime = utility::timer();
+#endif
+
+    _pbThds = numThds;
+    _pbCols = xColNum;
+
+    // the rows of a bin cover about PB_BIN_BYTES of y
+    idxType binRows = PB_BIN_BYTES/(xColNum*sizeof(valType));
+    _pbShift = 0;
+    while ((((idxType)1) << (_pbShift + 1)) <= binRows)
+        _pbShift++;
+
+    _pbNumBins = (_numVertices > 0) ? (((_numVertices - 1) >> _pbShift) + 1) : 0;
+
+    // contiguous columns of each thread with balanced nnz
+    _pbColStarts.assign(numThds + 1, _numVertices);
+    _pbColStarts[0] = 0;
+    int64_t nnzPerThd = ((int64_t)_nnZ + numThds - 1)/numThds;
+    idxType t = 1;
+    for (idxType i = 0; i < _numVertices; ++i) {
+        while (t < numThds && _indexCol[i] >= t*nnzPerThd)
+            _pbColStarts[t++] = i;
+    }
+
+    // entries of each (bin, thread)
+    std::vector<int64_t> counts((int64_t)_pbNumBins*numThds, 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (idxType t = 0; t < numThds; ++t) {
+        for (idxType i = _pbColStarts[t]; i < _pbColStarts[t+1]; ++i) {
+            for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+                counts[(_indexRow[j] >> _pbShift)*(int64_t)numThds + t]++;
+        }
+    }
+
+    _pbOffsets.resize(counts.size() + 1);
+    _pbOffsets[0] = 0;
+    for (int64_t i = 0; i < counts.size(); ++i) {
+        _pbOffsets[i+1] = _pbOffsets[i] + counts[i];
+    }
+
+    // destination rows in the order the payloads are written
+    _pbRows.resize(_nnZ);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (idxType t = 0; t < numThds; ++t) {
 
+        std::vector<int64_t> tails(_pbNumBins);
+        for (idxType b = 0; b < _pbNumBins; ++b) 
+            tails[b] = _pbOffsets[b*(int64_t)numThds + t];
+
+        for (idxType i = _pbColStarts[t]; i < _pbColStarts[t+1]; ++i) {
+            for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+                _pbRows[tails[_indexRow[j] >> _pbShift]++] = _indexRow[j];
+        }
+    }
+
+    if (_pbBins != nullptr)
+    {
+#ifdef __INTEL_COMPILER
+        _mm_free(_pbBins);
 #else
-            // compiler auto vectorization
-// #pragma omp simd
-//#pragma omp simd aligned(writeBufPtr, readBufPtr: 64)
+        free(_pbBins);
+#endif
+    }
+
+    int64_t binsLen = (int64_t)_nnZ*xColNum;
+#ifdef __INTEL_COMPILER
+    _pbBins = (valType*) _mm_malloc(binsLen*sizeof(valType), 64); 
+#else
+    _pbBins = (valType*) aligned_alloc(64, ((binsLen*sizeof(valType) + 63)/64)*64); 
+#endif
+
+    // first touch by the thread writing the bins
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (idxType t = 0; t < numThds; ++t) {
+        for (idxType b = 0; b < _pbNumBins; ++b) {
+            int64_t idx = b*(int64_t)numThds + t;
+            std::memset(_pbBins + _pbOffsets[idx]*xColNum, 0, (_pbOffsets[idx+1] - _pbOffsets[idx])*xColNum*sizeof(valType));
+        }
+    }
+
+#ifdef VERBOSE
+    printf("Propagation blocking with %d bins of %d rows, built using %f secs\n", _pbNumBins, 
+            (((idxType)1) << _pbShift), (utility::timer() - startTime));
+    std::fflush(stdout);
+#endif
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmPB(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+    if (_pbBins == nullptr || _pbThds != numThds || _pbCols < xColNum)
+        buildPropBlocking(numThds, xColNum);
+
+    // binning, a payload of 16 floats fills a cache line so each 
+    // bin is a sequential stream of full line writes
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (idxType t = 0; t < numThds; ++t) {
+
+        std::vector<int64_t> tails(_pbNumBins);
+        for (idxType b = 0; b < _pbNumBins; ++b) 
+            tails[b] = _pbOffsets[b*(int64_t)numThds + t];
+
+        for (idxType i = _pbColStarts[t]; i < _pbColStarts[t+1]; ++i) {
+
+            valType* readBufPtr = x + (int64_t)i*xColNum;
+            for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+            {
+                valType* writeBufPtr = _pbBins + (tails[_indexRow[j] >> _pbShift]++)*xColNum;
+                for (int k = 0; k < xColNum; ++k) {
+                    writeBufPtr[k] = readBufPtr[k];
+                }
+            }
+        }
+    }
+
+    // accumulation, the entries of a bin are contiguous over the 
+    // threads and only update the rows of the bin
+#pragma omp parallel for schedule(dynamic) num_threads(numThds)
+    for (idxType b = 0; b < _pbNumBins; ++b) {
+        for (int64_t e = _pbOffsets[b*(int64_t)numThds]; e < _pbOffsets[(b+1)*(int64_t)numThds]; ++e) 
+        {
+            valType* readBufPtr = _pbBins + e*xColNum;
+            valType* writeBufPtr = y + (int64_t)_pbRows[e]*xColNum;
             for (int k = 0; k < xColNum; ++k) {
-                writeBufPtr[k] += (readBufPtr[k]); 
+                writeBufPtr[k] += readBufPtr[k]; 
             }
+        }
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::buildTiles(idxType xColNum)
+{/*{{{*/
+
+#ifdef VERBOSE
+    double startTime = utility::timer();
 #endif
 
+    _tileCols = xColNum;
+
+    // tile sides fit TILE_BYTES and the 16-bit offsets
+    idxType tileRows = TILE_BYTES/(xColNum*sizeof(valType));
+    _tileShift = 0;
+    while (_tileShift < 16 && (((idxType)1) << (_tileShift + 1)) <= tileRows)
+        _tileShift++;
+
+    _numRowBlocks = (_numVertices > 0) ? (((_numVertices - 1) >> _tileShift) + 1) : 0;
 
+    // entries of each row block in the column order of CSC
+    std::vector<offType> rbEntryStarts(_numRowBlocks + 1, 0);
+    for (offType j = 0; j < _nnZ; ++j) 
+        rbEntryStarts[(_indexRow[j] >> _tileShift) + 1]++;
+
+    for (idxType rb = 0; rb < _numRowBlocks; ++rb) 
+        rbEntryStarts[rb+1] += rbEntryStarts[rb];
+
+    std::vector<idxType> entryRows(_nnZ);
+    std::vector<idxType> entryCols(_nnZ);
+    std::vector<offType> cursor(rbEntryStarts.begin(), rbEntryStarts.end() - 1);
+    for (idxType i = 0; i < _numVertices; ++i) {
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+        {
+            offType pos = cursor[_indexRow[j] >> _tileShift]++;
+            entryRows[pos] = _indexRow[j];
+            entryCols[pos] = i;
         }
     }
 
+    // a new tile starts at each change of column block
+    _rbTileStarts.assign(1, 0);
+    _tileColBlocks.clear();
+    _tileEntryStarts.clear();
+    _tileEntryRows.resize(_nnZ);
+    _tileEntryCols.resize(_nnZ);
+
+    idxType tileMask = (((idxType)1) << _tileShift) - 1;
+    for (idxType rb = 0; rb < _numRowBlocks; ++rb) 
+    {
+        for (offType j = rbEntryStarts[rb]; j < rbEntryStarts[rb+1]; ++j) 
+        {
+            idxType cb = entryCols[j] >> _tileShift;
+            if (j == rbEntryStarts[rb] || cb != _tileColBlocks.back())
+            {
+                _tileColBlocks.push_back(cb);
+                _tileEntryStarts.push_back(j);
+            }
+
+            _tileEntryRows[j] = (uint16_t)(entryRows[j] & tileMask);
+            _tileEntryCols[j] = (uint16_t)(entryCols[j] & tileMask);
+        }
+
+        _rbTileStarts.push_back(_tileColBlocks.size());
+    }
+
+    _tileEntryStarts.push_back(_nnZ);
+
+#ifdef VERBOSE
+    printf("Tiled SpMM with %d tiles of %d rows, built using %f secs\n", (idxType)_tileColBlocks.size(), 
+            (((idxType)1) << _tileShift), (utility::timer() - startTime));
+    std::fflush(stdout);
+#endif
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmTiled(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+    if (_tileCols < xColNum)
+        buildTiles(xColNum);
+
+    // row blocks own disjoint rows of y
+#pragma omp parallel for schedule(dynamic) num_threads(numThds)
+    for (idxType rb = 0; rb < _numRowBlocks; ++rb) 
+    {
+        valType* yTile = y + (((int64_t)rb) << _tileShift)*xColNum;
+        for (idxType t = _rbTileStarts[rb]; t < _rbTileStarts[rb+1]; ++t) 
+        {
+            valType* xTile = x + (((int64_t)_tileColBlocks[t]) << _tileShift)*xColNum;
+            for (offType j = _tileEntryStarts[t]; j < _tileEntryStarts[t+1]; ++j) 
+            {
+                valType* readBufPtr = xTile + _tileEntryCols[j]*xColNum;
+                valType* writeBufPtr = yTile + _tileEntryRows[j]*xColNum;
+                for (int k = 0; k < xColNum; ++k) {
+                    writeBufPtr[k] += readBufPtr[k]; 
+                }
+            }
+        }
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::compressAdjacency(bool releaseRaw)
+{/*{{{*/
+
+#ifdef VERBOSE
+    double startTime = utility::timer();
+#endif
+
+    // bytes of each column, 7 bits per byte, the high bit continues
+    _compOffsets.assign(_numVertices + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(omp_get_max_threads())
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        int64_t bytes = 0;
+        uint32_t prevRow = 0;
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+        {
+            uint32_t delta = (uint32_t)_indexRow[j] - prevRow;
+            prevRow = (uint32_t)_indexRow[j];
+            do {
+                bytes++;
+                delta >>= 7;
+            } while (delta > 0);
+        }
+        _compOffsets[i+1] = bytes;
+    }
+
+    for (idxType i = 0; i < _numVertices; ++i) 
+        _compOffsets[i+1] += _compOffsets[i];
+
+    _compAdj.resize(_compOffsets[_numVertices]);
+
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(omp_get_max_threads())
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        uint8_t* code = _compAdj.data() + _compOffsets[i];
+        uint32_t prevRow = 0;
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+        {
+            uint32_t delta = (uint32_t)_indexRow[j] - prevRow;
+            prevRow = (uint32_t)_indexRow[j];
+            while (delta >= 0x80) {
+                *(code++) = (uint8_t)(delta | 0x80);
+                delta >>= 7;
+            }
+            *(code++) = (uint8_t)delta;
+        }
+    }
+
+    if (releaseRaw)
+    {
+        free(_indexRow);
+        _indexRow = nullptr;
+
+        if (_splitsRowOffsets != nullptr)
+            delete[] _splitsRowOffsets; 
+
+        if (_splitsColIds != nullptr)
+            delete[] _splitsColIds; 
+
+        _splitsRowOffsets = nullptr;
+        _splitsColIds = nullptr;
+        _numsplits = 0;
+        _isRawReleased = true;
+    }
+
+#ifdef VERBOSE
+    double rawMB = ((double)_nnZ*2*sizeof(idxType) + (double)_numVertices*sizeof(offType))/1024/1024;
+    double compMB = ((double)_compAdj.size() + (_numVertices+1)*sizeof(int64_t))/1024/1024;
+    printf("Compressed adjacency %f MB from %f MB of rows and splits using %f secs\n", compMB, rawMB, 
+            (utility::timer() - startTime));
+    std::fflush(stdout);
+#endif
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmvCompressed(valType* x, valType* y, idxType numThds)
+{/*{{{*/
+
+    if (_compOffsets.empty())
+        compressAdjacency();
+
+    // column i of the symmetric matrix is also row i
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThds)
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        const uint8_t* code = _compAdj.data() + _compOffsets[i];
+        const uint8_t* codeEnd = _compAdj.data() + _compOffsets[i+1];
+        uint32_t row = 0;
+        valType sum = 0;
+        while (code < codeEnd) 
+        {
+            uint32_t delta = 0;
+            int shift = 0;
+            while (*code & 0x80) {
+                delta |= ((uint32_t)(*(code++) & 0x7f)) << shift;
+                shift += 7;
+            }
+            delta |= ((uint32_t)*(code++)) << shift;
+            row += delta;
+
+            sum += x[row];
+        }
+        y[i] += sum;
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmCompressed(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+    if (_compOffsets.empty())
+        compressAdjacency();
+
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThds)
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        const uint8_t* code = _compAdj.data() + _compOffsets[i];
+        const uint8_t* codeEnd = _compAdj.data() + _compOffsets[i+1];
+        valType* writeBufPtr = y + ((int64_t)i)*xColNum;
+        uint32_t row = 0;
+        while (code < codeEnd) 
+        {
+            uint32_t delta = 0;
+            int shift = 0;
+            while (*code & 0x80) {
+                delta |= ((uint32_t)(*(code++) & 0x7f)) << shift;
+                shift += 7;
+            }
+            delta |= ((uint32_t)*(code++)) << shift;
+            row += delta;
+
+            valType* readBufPtr = x + ((int64_t)row)*xColNum;
+            for (int k = 0; k < xColNum; ++k) {
+                writeBufPtr[k] += readBufPtr[k]; 
+            }
+        }
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmvPull(valType* x, valType* y, idxType numThds)
+{
+#pragma omp parallel for schedule(dynamic, 256) num_threads(numThds)
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        valType sum = 0;
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+            sum += x[_indexRow[j]];
+
+        y[i] += sum;
+    }
+}
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmmPull(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(numThds)
+    for (idxType i = 0; i < _numVertices; ++i) 
+    {
+        valType* writeBufPtr = y + ((int64_t)i)*xColNum;
+        for (offType j = _indexCol[i]; j < _indexCol[i+1]; ++j) 
+        {
+            valType* readBufPtr = x + ((int64_t)_indexRow[j])*xColNum;
+            for (int k = 0; k < xColNum; ++k) {
+                writeBufPtr[k] += readBufPtr[k]; 
+            }
+        }
+    }
+
+}/*}}}*/
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmv(valType* x, valType* y, idxType numThds, int backend)
+{
+    if (backend == SPMM_COMPRESSED || _isRawReleased)
+        spmvCompressed(x, y, numThds);
+    else if (backend == SPMM_PULL)
+        spmvPull(x, y, numThds);
+    else
+        spmvNaiveSplit(x, y, numThds);
+}
+
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::spmm(valType* x, valType* y, idxType xColNum, idxType numThds, int backend)
+{
+    if (backend == SPMM_COMPRESSED || _isRawReleased)
+        spmmCompressed(x, y, xColNum, numThds);
+    else if (backend == SPMM_PB)
+        spmmPB(x, y, xColNum, numThds);
+    else if (backend == SPMM_TILED)
+        spmmTiled(x, y, xColNum, numThds);
+    else if (backend == SPMM_PULL)
+        spmmPull(x, y, xColNum, numThds);
+    else
+        spmmSplit(x, y, xColNum, numThds);
 }
 
 // sparse matrix dense matrix (multiple dense vectors) 
 // used in benchmarking
-template<class idxType, class valType>
-double CSCGraph<idxType, valType>::spmmSplitExp(valType* x, valType* y, idxType xColNum, idxType numThds)
+template<class idxType, class valType, class offType>
+double CSCGraph<idxType, valType, offType>::spmmSplitExp(valType* x, valType* y, idxType xColNum, idxType numThds)
 {
     double startTime = 0.0;
     double conversionTime = 0.0;
@@ -336,69 +1302,7 @@ double CSCGraph<idxType, valType>::spmmSplitExp(valType* x, valType* y, idxType
     startTime = utility::timer();
 
     // doing the computation
-#pragma omp parallel for num_threads(numThds) 
-    for (idxType s = 0; s < _numsplits; ++s) 
-    {
-
-        std::vector<idxType>* localRowIds = &(_splitsRowIds[s]);
-        std::vector<idxType>* localColIds = &(_splitsColIds[s]);
-        // std::vector<valType>* localVals = &(_splitsVals[s]);
-        idxType localSize = localRowIds->size();
-
-
-        for (idxType j = 0; j < localSize; ++j) 
-        {
-            idxType colid = (*localColIds)[j];
-            idxType rowid = (*localRowIds)[j];
-            // valType val = (*localVals)[j];
-
-            valType* readBufPtr = readBuf + colid*xColNum;
-            valType* writeBufPtr = writeBuf + rowid*xColNum;
-
-#ifdef __INTEL_COMPILER
-            __assume_aligned(readBufPtr, 64);
-            __assume_aligned(writeBufPtr, 64);
-#else
-            __builtin_assume_aligned(readBufPtr, 64);
-            __builtin_assume_aligned(writeBufPtr, 64);
-#endif
-
-// #ifdef __AVX512F__ 
-//             // unrolled by 16 float
-//             int n16 = xColNum & ~(16-1); 
-//             __m512 tmpzero = _mm512_set1_ps (0);
-//             __mmask16 mask = (1 << (xColNum - n16)) - 1;
-//
-//             __m512 vecX;
-//             __m512 vecY;
-//             __m512 vecBuf;
-//
-//             for (int k = 0; k < n16; k+=16)
-//             {
-//                 vecX = _mm512_load_ps (&(readBufPtr[k]));
-//                 vecY = _mm512_load_ps (&(writeBufPtr[k]));
-//                 vecBuf = _mm512_add_ps(vecX, vecY);
-//                 _mm512_store_ps(&(writeBufPtr[k]), vecBuf);
-//             }
-//
-//             if (n16 < xColNum)
-//             {
-//                 vecX = _mm512_mask_load_ps(tmpzero, mask, &(readBufPtr[n16]));
-//                 vecY = _mm512_mask_load_ps(tmpzero, mask, &(writeBufPtr[n16]));
-//                 vecBuf = _mm512_add_ps(vecX, vecY);
-//                 _mm512_mask_store_ps(&(writeBufPtr[n16]), mask, vecBuf);
-//             }
-//
-// #else
-            // compiler auto vectorization
-#pragma omp simd aligned(writeBufPtr, readBufPtr: 64)
-            for (int k = 0; k < xColNum; ++k) {
-                writeBufPtr[k] += readBufPtr[k]; 
-            }
-// #endif
-
-        }
-    }
+    spmmSplit(readBuf, writeBuf, xColNum, numThds);
 
     computeTime += (utility::timer() - startTime);
     startTime = utility::timer();
@@ -424,42 +1328,164 @@ double CSCGraph<idxType, valType>::spmmSplitExp(valType* x, valType* y, idxType
 }
 
 
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::serialize(ofstream& outputFile)
+template<class idxType, class valType, class offType>
+void CSCGraph<idxType, valType, offType>::serialize(ofstream& outputFile)
+{/*{{{*/
+
+    // graphs of 32-bit ids and up to INT32_MAX entries keep the older format
+    if (sizeof(idxType) == sizeof(int32_t) && _nnZ <= INT32_MAX)
+    {
+        int32_t numEdges = (int32_t)_numEdges;
+        outputFile.write((char*)&numEdges, sizeof(int32_t));
+        outputFile.write((char*)&_numVertices, sizeof(idxType));
+        outputFile.write((char*)_degList, _numVertices*sizeof(idxType));
+
+        std::vector<int32_t> indexCol(_indexCol, _indexCol + _numVertices + 1);
+        outputFile.write((char*)indexCol.data(), (_numVertices+1)*sizeof(int32_t));
+        outputFile.write((char*)_indexRow, _nnZ*sizeof(idxType));
+
+        // the format keeps the unit values of the entries
+        std::vector<valType> unitVals(std::min(_nnZ, (offType)(1 << 16)), 1.0);
+        for (offType i = 0; i < _nnZ; i += unitVals.size()) 
+            outputFile.write((char*)unitVals.data(), std::min((offType)unitVals.size(), _nnZ - i)*sizeof(valType));
+    }
+    else
+    {
+        // tag, bytes of a vertex id and of an offset, then 64-bit counts
+        int32_t header[3] = {CSC_BIN_WIDE_TAG, (int32_t)sizeof(idxType), (int32_t)sizeof(offType)};
+        int64_t counts[2] = {(int64_t)_numEdges, (int64_t)_numVertices};
+        outputFile.write((char*)header, 3*sizeof(int32_t));
+        outputFile.write((char*)counts, 2*sizeof(int64_t));
+        outputFile.write((char*)_degList, _numVertices*sizeof(idxType));
+        outputFile.write((char*)_indexCol, (_numVertices+1)*sizeof(offType));
+        outputFile.write((char*)_indexRow, _nnZ*sizeof(idxType));
+    }
+
+    // optional vertex permutation at the end
+    idxType hasPerm = (_permutation != nullptr) ? 1 : 0;
+    outputFile.write((char*)&hasPerm, sizeof(idxType));
+    if (hasPerm)
+        outputFile.write((char*)_permutation, _numVertices*sizeof(idxType));
+
+}/*}}}*/
+
+// a single read returns at most about 2GB
+template<class idxType, class valType, class offType>
+bool CSCGraph<idxType, valType, offType>::readFull(int inputFile, char* buf, int64_t bytes)
 {
-    outputFile.write((char*)&_numEdges, sizeof(idxType));
-    outputFile.write((char*)&_numVertices, sizeof(idxType));
-    outputFile.write((char*)_degList, _numVertices*sizeof(idxType));
-    outputFile.write((char*)_indexCol, (_numVertices+1)*sizeof(idxType));
-    outputFile.write((char*)_indexRow, (_indexCol[_numVertices])*sizeof(idxType));
-    outputFile.write((char*)_edgeVal, (_indexCol[_numVertices])*sizeof(valType));
+    while (bytes > 0)
+    {
+        ssize_t len = read(inputFile, buf, std::min(bytes, (int64_t)(1 << 30)));
+        if (len <= 0)
+            return false;
+
+        buf += len;
+        bytes -= len;
+    }
+
+    return true;
 }
         
-template<class idxType, class valType>
-void CSCGraph<idxType, valType>::deserialize(int inputFile)
-{
+template<class idxType, class valType, class offType>
+bool CSCGraph<idxType, valType, offType>::deserialize(int inputFile)
+{/*{{{*/
+
+    // the widths of the file are known from its first field
+    int32_t tag = 0;
+    int32_t widths[2] = {(int32_t)sizeof(int32_t), (int32_t)sizeof(int32_t)};
+    int64_t counts[2] = {0, 0};
+    bool isWide = false;
+
+    bool isRead = readFull(inputFile, (char*)&tag, sizeof(int32_t));
+    if (isRead && tag == CSC_BIN_WIDE_TAG)
+    {
+        isWide = true;
+        isRead = readFull(inputFile, (char*)widths, 2*sizeof(int32_t))
+            && readFull(inputFile, (char*)counts, 2*sizeof(int64_t));
+    }
+    else if (isRead)
+    {
+        int32_t numVerts = 0;
+        isRead = readFull(inputFile, (char*)&numVerts, sizeof(int32_t));
+        counts[0] = tag;
+        counts[1] = numVerts;
+    }
 
-    read(inputFile, (char*)&_numEdges, sizeof(idxType));
-    read(inputFile, (char*)&_numVertices, sizeof(idxType));
+    if (!isRead)
+    {
+        fprintf(stderr, "CSC binary header is truncated\n");
+        return false;
+    }
 
-    _degList = (idxType*) malloc (_numVertices*sizeof(idxType)); 
-    read(inputFile, (char*)_degList, _numVertices*sizeof(idxType));
+    if (widths[0] != sizeof(idxType) || widths[1] > sizeof(offType) || counts[1] < 0)
+    {
+        fprintf(stderr, "CSC binary of %d-byte vertex ids and %d-byte offsets does not fit this graph\n", 
+                widths[0], widths[1]);
+        return false;
+    }
 
-    _indexCol = (idxType*) malloc ((_numVertices+1)*sizeof(idxType)); 
-    read(inputFile, (char*)_indexCol, (_numVertices+1)*sizeof(idxType));
+    _numEdges = counts[0];
+    _numVertices = (idxType)counts[1];
+
+    _degList = (idxType*) malloc (_numVertices*sizeof(idxType)); 
+    if (!readFull(inputFile, (char*)_degList, _numVertices*sizeof(idxType)))
+    {
+        fprintf(stderr, "CSC binary is truncated in the degree list\n");
+        return false;
+    }
 
-    _indexRow = (idxType*) malloc (_indexCol[_numVertices]*sizeof(idxType)); 
-    read(inputFile, (char*)_indexRow, (_indexCol[_numVertices])*sizeof(idxType));
+    // narrower offsets are widened in place from the end
+    _indexCol = (offType*) malloc ((_numVertices+1)*sizeof(offType)); 
+    if (!readFull(inputFile, (char*)_indexCol, (_numVertices+1)*(int64_t)widths[1]))
+    {
+        fprintf(stderr, "CSC binary is truncated in the column offsets\n");
+        return false;
+    }
 
-    _edgeVal = (valType*) malloc ((_indexCol[_numVertices])*sizeof(valType)); 
-    read(inputFile, (char*)_edgeVal, (_indexCol[_numVertices])*sizeof(valType));
+    if (widths[1] == sizeof(int32_t) && sizeof(offType) > sizeof(int32_t))
+    {
+        int32_t* narrowCol = (int32_t*)_indexCol;
+        for (int64_t i = _numVertices; i >= 0; --i)
+            _indexCol[i] = narrowCol[i];
+    }
 
     _nnZ = _indexCol[_numVertices];
+    if (_nnZ < 0)
+    {
+        fprintf(stderr, "CSC binary has a negative number of entries (%ld)\n", (long)_nnZ);
+        return false;
+    }
+
+    _indexRow = (idxType*) malloc (_nnZ*sizeof(idxType)); 
+    if (!readFull(inputFile, (char*)_indexRow, _nnZ*sizeof(idxType)))
+    {
+        fprintf(stderr, "CSC binary is truncated in the row ids\n");
+        return false;
+    }
+
+    // skip the unit values of the older format
+    if (!isWide)
+        lseek(inputFile, ((off_t)_nnZ)*sizeof(valType), SEEK_CUR);
+
+    // files written before the permutation was stored end here
+    idxType hasPerm = 0;
+    if (readFull(inputFile, (char*)&hasPerm, sizeof(idxType)) && hasPerm == 1)
+    {
+        _permutation = (idxType*) malloc (_numVertices*sizeof(idxType)); 
+        if (!readFull(inputFile, (char*)_permutation, _numVertices*sizeof(idxType)))
+        {
+            fprintf(stderr, "CSC binary is truncated in the permutation\n");
+            return false;
+        }
+    }
 
-    printf("CSC Format Total vertices is : %d\n", _numVertices);
-    printf("CSC Format Total Edges is : %d\n", _numEdges);
+    printf("CSC Format Total vertices is : %ld\n", (long)_numVertices);
+    printf("CSC Format Total Edges is : %ld, %d-byte ids and %d-byte offsets in file\n", (long)_numEdges, 
+            widths[0], widths[1]);
     std::fflush(stdout); 
 
-}
+    return true;
+
+}/*}}}*/
 
 #endif
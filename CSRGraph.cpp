@@ -1,6 +1,8 @@
 #include "CSRGraph.hpp"
 #include <cstring>
 #include <cstdlib>
+#include <vector>
+#include <algorithm>
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -58,14 +60,16 @@ void CSRGraph::createFromEdgeListFile(CSRGraph::idxType numVerts, CSRGraph::idxT
     _indexCol = (CSRGraph::idxType*)malloc
         (_indexRow[_numVertices]*sizeof(CSRGraph::idxType));
 
+#ifndef PATTERN_ONLY
     _edgeVal = (CSRGraph::valType*)malloc
         (_indexRow[_numVertices]*sizeof(CSRGraph::valType));
 
 #pragma omp parallel for num_threads(omp_get_max_threads())
     for (int i = 0; i < _indexRow[_numVertices]; ++i) {
-        _edgeVal[i] = 0;
+        _edgeVal[i] = 1.0;
     }
     // std::memset(_edgeVal, 0, _indexRow[_numVertices]*sizeof(CSRGraph::valType));
+#endif
 
     for(CSRGraph::idxType i = 0; i< _numEdges; i++)
     {
@@ -73,15 +77,11 @@ void CSRGraph::createFromEdgeListFile(CSRGraph::idxType numVerts, CSRGraph::idxT
         CSRGraph::idxType srcId = srcList[i];
         CSRGraph::idxType dstId = dstList[i];
 
-        _indexCol[_indexRow[srcId]] = dstId;
-        _edgeVal[(_indexRow[srcId])++] = 1.0;
+        _indexCol[(_indexRow[srcId])++] = dstId;
 
         // non-directed graph
         if (!_isDirected)
-        {
-            _indexCol[_indexRow[dstId]] = srcId;
-            _edgeVal[(_indexRow[dstId])++] = 1.0;
-        }
+            _indexCol[(_indexRow[dstId])++] = srcId;
     }
 
     // recover the indexRow 
@@ -136,12 +136,19 @@ void CSRGraph::SpMVNaiveFull(valType* x, valType* y)
         valType sum = 0.0;
 
         idxType rowLen = getRowLen(i);
-        valType* rowElem = getEdgeVals(i); 
         idxType* rowColIdx = getColIdx(i);
 
+#ifdef PATTERN_ONLY
+        // unit entries, no values to load
+        for(idxType j=0; j<rowLen;j++)
+            sum += (x[rowColIdx[j]]);
+#else
+        valType* rowElem = getEdgeVals(i); 
+
         //#pragma omp simd reduction(+:sum) 
         for(idxType j=0; j<rowLen;j++)
             sum += rowElem[j] * (x[rowColIdx[j]]);
+#endif
 
         y[i] = sum;
     }
@@ -156,12 +163,18 @@ void CSRGraph::SpMVNaiveScale(valType* x, valType* y, float scale)
         double sum = 0.0;
 
         idxType rowLen = getRowLen(i);
-        valType* rowElem = getEdgeVals(i); 
         idxType* rowColIdx = getColIdx(i);
 
+#ifdef PATTERN_ONLY
+        for(idxType j=0; j<rowLen;j++)
+            sum += ((double)scale*(x[rowColIdx[j]]));
+#else
+        valType* rowElem = getEdgeVals(i); 
+
         //#pragma omp simd reduction(+:sum) 
         for(idxType j=0; j<rowLen;j++)
             sum += rowElem[j]*((double)scale*(x[rowColIdx[j]]));
+#endif
 
         y[i] = (float)sum;
     }
@@ -196,17 +209,200 @@ void CSRGraph::SpMVNaiveFull(valType* x, valType* y, int thdNum)
         valType sum = 0.0;
 
         idxType rowLen = getRowLen(i);
-        valType* rowElem = getEdgeVals(i); 
         idxType* rowColIdx = getColIdx(i);
 
+#ifdef PATTERN_ONLY
+        // unit entries, no values to load
+        for(idxType j=0; j<rowLen;j++)
+            sum += (x[rowColIdx[j]]);
+#else
+        valType* rowElem = getEdgeVals(i); 
+
         //#pragma omp simd reduction(+:sum) 
         for(idxType j=0; j<rowLen;j++)
             sum += rowElem[j] * (x[rowColIdx[j]]);
+#endif
 
         y[i] = sum;
     }
 }
 
+// the coordinates (rows done, nnz done) where the merge path of the
+// row ends and the nnz indices crosses the diagonal diag
+void CSRGraph::mergePathSearch(int64_t diag, idxType* rowPtr, idxType base, idxType numRows, int64_t nnz, 
+        idxType& row, int64_t& nz)
+{
+    int64_t lo = std::max((int64_t)0, diag - nnz);
+    int64_t hi = std::min(diag, (int64_t)numRows);
+    while (lo < hi)
+    {
+        int64_t mid = (lo + hi)/2;
+        if ((int64_t)rowPtr[mid+1] - base <= diag - mid - 1)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    row = (idxType)lo;
+    nz = diag - lo;
+}
+
+// each thread takes an equal share of rows plus nnz, 
+// the row split at the end of a share is fixed up after
+void CSRGraph::SpMVMergePath(valType* x, valType* y, int thdNum)
+{/*{{{*/
+
+    idxType numRows = getNumVertices();
+    idxType* rowPtr = getIndexRow();
+    idxType* colIdx = getIndexCol();
+#ifndef PATTERN_ONLY
+    valType* vals = getNNZVal();
+#endif
+
+    idxType base = _isOneBased ? 1 : 0;
+    int64_t nnz = (int64_t)rowPtr[numRows] - base;
+    int64_t pathLen = (int64_t)numRows + nnz;
+
+    std::vector<idxType> carryRows(thdNum, numRows);
+    std::vector<valType> carryVals(thdNum, 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(thdNum)
+    for (int t = 0; t < thdNum; ++t) 
+    {
+        idxType rowStart = 0;
+        idxType rowEnd = 0;
+        int64_t nzStart = 0;
+        int64_t nzEnd = 0;
+        mergePathSearch(pathLen*t/thdNum, rowPtr, base, numRows, nnz, rowStart, nzStart);
+        mergePathSearch(pathLen*(t+1)/thdNum, rowPtr, base, numRows, nnz, rowEnd, nzEnd);
+
+        int64_t j = nzStart;
+        for (idxType i = rowStart; i < rowEnd; ++i) 
+        {
+            valType sum = 0.0;
+            for (; j < (int64_t)rowPtr[i+1] - base; ++j) 
+#ifdef PATTERN_ONLY
+                sum += x[colIdx[j] - base];
+#else
+                sum += vals[j]*x[colIdx[j] - base];
+#endif
+
+            y[i] = sum;
+        }
+
+        valType sum = 0.0;
+        for (; j < nzEnd; ++j) 
+#ifdef PATTERN_ONLY
+            sum += x[colIdx[j] - base];
+#else
+            sum += vals[j]*x[colIdx[j] - base];
+#endif
+
+        carryRows[t] = rowEnd;
+        carryVals[t] = sum;
+    }
+
+    for (int t = 0; t < thdNum; ++t) {
+        if (carryRows[t] < numRows)
+            y[carryRows[t]] += carryVals[t];
+    }
+
+}/*}}}*/
+
+/**
+ * @brief y = A*x on row-major x and y, the merge path of rows and nnz is 
+ * cut into equal pieces so that a hub row is shared by several threads. 
+ * Each row is accumulated in registers and written once, the partial sum 
+ * of the row a thread stops in is carried out and added after the 
+ * parallel loop, no atomics are needed
+ *
+ * @param x
+ * @param y
+ * @param xColNum
+ * @param thdNum
+ */
+void CSRGraph::SpMMMergePath(valType* x, valType* y, int xColNum, int thdNum)
+{/*{{{*/
+
+    idxType numRows = getNumVertices();
+    idxType* rowPtr = getIndexRow();
+    idxType* colIdx = getIndexCol();
+#ifndef PATTERN_ONLY
+    valType* vals = getNNZVal();
+#endif
+
+    // the indices are one-based once made for MKL
+    idxType base = _isOneBased ? 1 : 0;
+    int64_t nnz = (int64_t)rowPtr[numRows] - base;
+    int64_t pathLen = (int64_t)numRows + nnz;
+
+    std::vector<idxType> carryRows(thdNum, numRows);
+    std::vector<valType> carryVals((int64_t)thdNum*xColNum, 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(thdNum)
+    for (int t = 0; t < thdNum; ++t) 
+    {
+        idxType rowStart = 0;
+        idxType rowEnd = 0;
+        int64_t nzStart = 0;
+        int64_t nzEnd = 0;
+        mergePathSearch(pathLen*t/thdNum, rowPtr, base, numRows, nnz, rowStart, nzStart);
+        mergePathSearch(pathLen*(t+1)/thdNum, rowPtr, base, numRows, nnz, rowEnd, nzEnd);
+
+        for (int c = 0; c < xColNum; c += CSR_SPMM_MAX_COLS) 
+        {
+            int width = std::min(CSR_SPMM_MAX_COLS, xColNum - c);
+            valType acc[CSR_SPMM_MAX_COLS];
+            int64_t j = nzStart;
+
+            // rows completed by this thread
+            for (idxType i = rowStart; i <= rowEnd; ++i) 
+            {
+                int64_t rowStop = (i < rowEnd) ? ((int64_t)rowPtr[i+1] - base) : nzEnd;
+
+                for (int k = 0; k < width; ++k) 
+                    acc[k] = 0;
+
+                for (; j < rowStop; ++j) 
+                {
+                    valType* readBufPtr = x + ((int64_t)colIdx[j] - base)*xColNum + c;
+#ifdef PATTERN_ONLY
+                    for (int k = 0; k < width; ++k) 
+                        acc[k] += readBufPtr[k];
+#else
+                    for (int k = 0; k < width; ++k) 
+                        acc[k] += vals[j]*readBufPtr[k];
+#endif
+                }
+
+                if (i < rowEnd)
+                {
+                    valType* writeBufPtr = y + ((int64_t)i)*xColNum + c;
+                    for (int k = 0; k < width; ++k) 
+                        writeBufPtr[k] = acc[k];
+                }
+                else if (rowEnd < numRows)
+                {
+                    // the row continues on the next thread
+                    carryRows[t] = rowEnd;
+                    for (int k = 0; k < width; ++k) 
+                        carryVals[(int64_t)t*xColNum + c + k] = acc[k];
+                }
+            }
+        }
+    }
+
+    for (int t = 0; t < thdNum; ++t) {
+        if (carryRows[t] < numRows)
+        {
+            valType* writeBufPtr = y + ((int64_t)carryRows[t])*xColNum;
+            for (int k = 0; k < xColNum; ++k) 
+                writeBufPtr[k] += carryVals[(int64_t)t*xColNum + k];
+        }
+    }
+
+}/*}}}*/
+
 void CSRGraph::SpMVMKL(valType* x, valType* y, int thdNum)
 {
 #ifndef NEC
@@ -216,7 +412,7 @@ void CSRGraph::SpMVMKL(valType* x, valType* y, int thdNum)
     }
     else
     {
-        SpMVNaive(x,y,thdNum);
+        SpMVMergePath(x,y,thdNum);
     }
 
     // mkl_set_num_threads(thdNum);
@@ -240,7 +436,15 @@ void CSRGraph::serialize(ofstream& outputFile)
     outputFile.write((char*)_degList, _numVertices*sizeof(idxType));
     outputFile.write((char*)_indexRow, (_numVertices+1)*sizeof(idxType));
     outputFile.write((char*)_indexCol, (_indexRow[_numVertices])*sizeof(idxType));
+#ifdef PATTERN_ONLY
+    // the format keeps the unit values of the entries
+    idxType nnz = _indexRow[_numVertices];
+    std::vector<valType> unitVals(std::min(nnz, (idxType)(1 << 16)), 1.0);
+    for (idxType i = 0; i < nnz; i += unitVals.size()) 
+        outputFile.write((char*)unitVals.data(), std::min((idxType)unitVals.size(), nnz - i)*sizeof(valType));
+#else
     outputFile.write((char*)_edgeVal, (_indexRow[_numVertices])*sizeof(valType));
+#endif
 }
 
 void CSRGraph::toASCII(string fileName)
@@ -253,7 +457,11 @@ void CSRGraph::toASCII(string fileName)
     for (int i = 0; i < _numVertices; ++i) {
 
         for (int j = _indexRow[i]; j < _indexRow[i+1]; ++j) {
+#ifdef PATTERN_ONLY
+            outputFile<<(i+1)<<" "<<(_indexCol[j]+1)<<" "<<1.0<<std::endl; 
+#else
             outputFile<<(i+1)<<" "<<(_indexCol[j]+1)<<" "<<_edgeVal[j]<<std::endl; 
+#endif
         }
     }
     outputFile.close();
@@ -273,8 +481,13 @@ void CSRGraph::deserialize(int inputFile, bool useMKL, bool useRcm)
     _indexCol = (idxType*) malloc ((_indexRow[_numVertices])*sizeof(idxType)); 
     read(inputFile, (char*)_indexCol, (_indexRow[_numVertices])*sizeof(idxType));
 
+#ifdef PATTERN_ONLY
+    // skip the unit values
+    lseek(inputFile, ((off_t)_indexRow[_numVertices])*sizeof(valType), SEEK_CUR);
+#else
     _edgeVal = (valType*) malloc ((_indexRow[_numVertices])*sizeof(valType)); 
     read(inputFile, (char*)_edgeVal, (_indexRow[_numVertices])*sizeof(valType));
+#endif
 
     _nnZ = _indexRow[_numVertices];
 
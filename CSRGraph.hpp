@@ -6,6 +6,7 @@
 #include <fstream>
 #include <algorithm>
 #include <iostream>
+#include "Helper.hpp"
 
 #ifndef NEC
 #include "SpDM3/include/spmat.h"
@@ -16,6 +17,9 @@
 
 using namespace std;
 
+// columns of x accumulated in registers by a row of SpMMMergePath
+#define CSR_SPMM_MAX_COLS 16
+
 // store the edgelist graph data into a CSR format (non-symmetric)
 // use float type for entry and avoid the type conversion with count data
 class CSRGraph
@@ -50,6 +54,7 @@ class CSRGraph
 #endif
         }
 
+#ifndef PATTERN_ONLY
         valType* getEdgeVals(idxType rowId)
         {
 #ifndef NEC
@@ -58,6 +63,7 @@ class CSRGraph
             return (_edgeVal + _indexRow[rowId]); 
 #endif
         }
+#endif
 
         idxType* getColIdx(idxType rowId)
         {
@@ -84,6 +90,11 @@ class CSRGraph
         void SpMVNaiveFull(valType* x, valType* y, int thdNum);
         void SpMVMKL(valType* x, valType* y, int thdNum);
         void SpMVMKLHint(int callNum);
+        // y = A*x balanced by merge path, the default CSR SpMV of the counting
+        void SpMVMergePath(valType* x, valType* y, int thdNum);
+        // y = A*x with xColNum columns of x and y in row-major, 
+        // portable row-parallel SpMM balanced by merge path
+        void SpMMMergePath(valType* x, valType* y, int xColNum, int thdNum);
 #ifndef NEC
         idxType getNumVertices() {return (_rcmMatR != nullptr) ? _rcmMatR->m : _numVertices;} 
 #else
@@ -99,7 +110,6 @@ class CSRGraph
         idxType getNNZ() {return _indexRow[_numVertices]; }
         idxType* getIndexRow() {return _indexRow;}
         idxType* getIndexCol() {return _indexCol;}
-        valType* getNNZVal() {return _edgeVal;} 
 #endif
          
         void createFromEdgeListFile(idxType numVerts, idxType numEdges, 
@@ -125,6 +135,9 @@ class CSRGraph
 
     private:
 
+        static void mergePathSearch(int64_t diag, idxType* rowPtr, idxType base, idxType numRows, int64_t nnz, 
+                idxType& row, int64_t& nz);
+
         bool _isDirected;
         bool _isOneBased;
         idxType _numEdges;
@@ -9,6 +9,7 @@
 #include <omp.h>
 #include <vector>
 #include <map>
+#include <algorithm>
 #ifndef NEC
 #include "mkl.h"
 #endif
@@ -29,6 +30,50 @@ void CountMat::initialization(CSRGraph* graph, CSCGraph<int32_t, float>* graphCS
     else
         _vert_num = _graphCSC->getNumVertices();
 
+    initBuffers(thd_num, itr_num, isPruned, useSPMM, vtuneStart, calculate_automorphisms, 0);
+}
+
+#ifdef DISTRI
+void CountMat::initialization(DistCSCGraph* graph, int thd_num, int itr_num, int vtuneStart, bool calculate_automorphisms)
+{
+    _graphDist = graph;
+    _vert_num = _graphDist->getNumVertices();
+
+    // only the pruned SpMM exchanges halo rows
+    initBuffers(thd_num, itr_num, 1, 1, vtuneStart, calculate_automorphisms, _graphDist->getHaloNum());
+
+    // a second SpMM input for the batch in exchange
+    if (_graphDist->hasHalo())
+    {
+        // rounded up as _bufMatX for the vector kernels
+        idxType xRows = ((_vert_num + _graphDist->getHaloNum() + 15)/16)*16;
+        int64_t xLen = (int64_t)xRows*_bufMatCols;
+#ifdef __INTEL_COMPILER
+        _bufMatXNext = (float*) _mm_malloc(xLen*sizeof(float), 64); 
+#else
+        _bufMatXNext = (float*) aligned_alloc(64, xLen*sizeof(float)); 
+#endif
+    }
+
+    // the same seed on all ranks, with a distinct color stream per rank
+    MPI_Bcast(&_colorSeed, 1, MPI_UNSIGNED, 0, _graphDist->getComm());
+    _colorSeed += 0x9e3779b9u*_graphDist->getRank();
+}
+
+void CountMat::setIterationComm(MPI_Comm comm)
+{
+    _itrComm = comm;
+    MPI_Comm_rank(_itrComm, &_itrRank);
+    MPI_Comm_size(_itrComm, &_itrProcNum);
+
+    // the iterations share the seed and differ by their color streams
+    MPI_Bcast(&_colorSeed, 1, MPI_UNSIGNED, 0, _itrComm);
+}
+#endif
+
+void CountMat::initBuffers(int thd_num, int itr_num, int isPruned, int useSPMM, int vtuneStart, 
+        bool calculate_automorphisms, idxType haloNum)
+{
     _thd_num = thd_num;
     _itr_num = itr_num;
     _isPruned = isPruned;
@@ -36,6 +81,10 @@ void CountMat::initialization(CSRGraph* graph, CSCGraph<int32_t, float>* graphCS
     _isScaled = 0;
     _vtuneStart = vtuneStart;
     _calculate_automorphisms = calculate_automorphisms;
+    _colorSeed = time(0);
+    _colorItr = 0;
+    _itrRank = 0;
+    _itrProcNum = 1;
 
     // mkl spmm use one-based csr
     if (_graph != nullptr && _graph->useMKL() && _useSPMM == 1)
@@ -61,45 +110,388 @@ void CountMat::initialization(CSRGraph* graph, CSCGraph<int32_t, float>* graphCS
     // doing 16 SIMD float operations 
     _bufMatCols = 16;
 
+    // no kernel timed yet for SPMM_AUTO
+    _pushTimes.assign(_bufMatCols + 1, -1.0);
+    _pullTimes.assign(_bufMatCols + 1, -1.0);
+
+    // the input of SpMM also holds the halo rows from remote vertices, 
+    // and the aligned columns of a streamed SpMM output
+    idxType xRows = ((_vert_num + haloNum + 15)/16)*16;
 #ifdef __INTEL_COMPILER
-    _bufMatY = (float*) _mm_malloc(_vert_num*_bufMatCols*sizeof(float), 64); 
-    _bufMatX = (float*) _mm_malloc(_vert_num*_bufMatCols*sizeof(float), 64); 
+    _bufMatY = (float*) _mm_malloc((int64_t)_vert_num*_bufMatCols*sizeof(float), 64); 
+    _bufMatX = (float*) _mm_malloc((int64_t)xRows*_bufMatCols*sizeof(float), 64); 
 #else
-    _bufMatY = (float*) aligned_alloc(64, _vert_num*_bufMatCols*sizeof(float)); 
-    _bufMatX = (float*) aligned_alloc(64, _vert_num*_bufMatCols*sizeof(float)); 
+    _bufMatY = (float*) aligned_alloc(64, (int64_t)_vert_num*_bufMatCols*sizeof(float)); 
+    _bufMatX = (float*) aligned_alloc(64, (int64_t)xRows*_bufMatCols*sizeof(float)); 
 #endif
 
 #pragma omp parallel for num_threads(omp_get_max_threads())
-    for (int i = 0; i < _vert_num*_bufMatCols; ++i) {
-        _bufMatX[i] = 0;
+    for (int64_t i = 0; i < (int64_t)_vert_num*_bufMatCols; ++i) {
         _bufMatY[i] = 0;
     }
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int64_t i = 0; i < (int64_t)xRows*_bufMatCols; ++i) {
+        _bufMatX[i] = 0;
+    }
 }
 
+void CountMat::getGraphSize(idxType& n, offType& nnz)
+{
+    if (_graph != nullptr)
+    {
+        n = _graph->getNumVertices();
+        nnz = _graph->getNNZ();
+    }
+    else if (_graphCSC != nullptr)
+    {
+        n = _graphCSC->getNumVertices();
+        nnz = _graphCSC->getNNZ();
+    }
+#ifdef DISTRI
+    else
+    {
+        n = _graphDist->getNumVertices();
+        nnz = _graphDist->getNNZ();
+    }
+#endif
+}
+
+/**
+ * @brief y += A*x on the CSC graph, a width of 0 is a SpMV. With SPMM_AUTO
+ * the first call of a width runs the push kernel (CSC-Split) and the second
+ * one the pull kernel, the faster of the two then serves all the batches 
+ * of that width. The kernel time only depends on the graph and the width, 
+ * so the probe is shared by the sub-templates
+ *
+ * @param x
+ * @param y
+ * @param width
+ */
+void CountMat::multiplyCSC(valType* x, valType* y, int width)
+{/*{{{*/
+
+    int slot = std::max(width, 1);
+    int backend = _spmmBackend;
+    if (_spmmBackend == SPMM_AUTO)
+    {
+        if (_pushTimes[slot] < 0)
+            backend = SPMM_SPLIT;
+        else if (_pullTimes[slot] < 0)
+            backend = SPMM_PULL;
+        else
+            backend = (_pullTimes[slot] < _pushTimes[slot]) ? SPMM_PULL : SPMM_SPLIT;
+    }
+
+    double startTime = utility::timer();
+
+    if (width == 0)
+        _graphCSC->spmv(x, y, _thd_num, backend);
+    else
+        _graphCSC->spmm(x, y, width, _thd_num, backend);
+
+    if (_spmmBackend != SPMM_AUTO)
+        return;
+
+    double elapsed = utility::timer() - startTime;
+    if (backend == SPMM_SPLIT && _pushTimes[slot] < 0)
+        _pushTimes[slot] = elapsed;
+    else if (backend == SPMM_PULL && _pullTimes[slot] < 0)
+    {
+        _pullTimes[slot] = elapsed;
+#ifdef VERBOSE
+        printf("SpMM of %d cols: push %f secs, pull %f secs, use %s\n", width, _pushTimes[slot], _pullTimes[slot], 
+                (_pullTimes[slot] < _pushTimes[slot]) ? "pull" : "push");
+        std::fflush(stdout);
+#endif
+    }
+
+}/*}}}*/
+
 double CountMat::compute(Graph& templates, bool isEstimate)
 {/*{{{*/
+    double finalCount = 0.0;
+    compute(&templates, 1, &finalCount, isEstimate);
+    return finalCount;
+}/*}}}*/
+
+void CountMat::compute(Graph* templates, int templateNum, double* finalCounts, bool isEstimate)
+{/*{{{*/
+
+    for (int t = 0; t < templateNum; ++t) {
+        finalCounts[t] = 0.0;
+    }
+
+    // all of the templates are counted upon the same colorings
+    _color_num = templates[0].get_vert_num();
+    for (int t = 1; t < templateNum; ++t) {
+        if (templates[t].get_vert_num() != _color_num)
+        {
+            fprintf(stderr, "Templates of different sizes cannot share colorings\n");
+            return;
+        }
+    }
+
+    _templateList = templates;
+    _templateNum = templateNum;
+    _divList = new DivideTemplates[_templateNum];
+    _indexerList = new IndexSys[_templateNum];
+    _dTableList = new DataTableColMajor[_templateNum];
+    _subtmpList = new Graph*[_templateNum];
+
+    for (int t = 0; t < _templateNum; ++t) {
+        prepareTemplate(t);
+    }
+
+    // exit without counting
+    if (isEstimate)
+        return;
+
+#ifdef VERBOSE
+    printf("Start counting\n");
+    std::fflush(stdout); 
+#endif
+
+    // find the sub-templates shared by several templates
+    planSharedSubTemps();
+
+    // allocating the bufVecLeaf buffer
+    _bufVecLeaf = (float**) malloc (_color_num*sizeof(float*));
+    if (_useSPMM == 0)
+    {
+        for (int i = 0; i < _color_num; ++i) {
+#ifdef __INTEL_COMPILER
+            _bufVecLeaf[i] =  (float*) _mm_malloc(_vert_num*sizeof(float), 64); 
+#else
+            _bufVecLeaf[i] =  (float*) aligned_alloc(64, _vert_num*sizeof(float)); 
+#endif 
+        }
+
+    }
+    else
+    {
+#ifdef __INTEL_COMPILER
+        _bufVecLeaf[0] =  (float*) _mm_malloc((int64_t)(_vert_num)*_color_num*sizeof(float), 64); 
+#else
+        _bufVecLeaf[0] =  (float*) aligned_alloc(64, (int64_t)(_vert_num)*_color_num*sizeof(float)); 
+#endif 
+
+        for (int i = 1; i < _color_num; ++i) {
+           _bufVecLeaf[i] = _bufVecLeaf[0] + (int64_t)i*_vert_num; 
+        }
+    }
+
+    // start counting
+    double timeStart = utility::timer();
+
+    std::vector<double> iterCount(_templateNum, 0.0);
+    std::vector<double> iterSqCount(_templateNum, 0.0);
+    unsigned int itrBase = _colorItr;
+    for (int i = 0; i < _itr_num; ++i) {
+
+        // the other processes count the rest of iterations
+        if (i % _itrProcNum != _itrRank)
+            continue;
+
+        // the color stream of an iteration does not depend on the process
+        _colorItr = itrBase + i;
+        colorInit();
+
+        for (int t = 0; t < _templateNum; ++t) {
+            selectTemplate(t);
+            double count = colorCounting();
+            iterCount[t] += count;
+            iterSqCount[t] += count*count;
+        }
+
+        releaseSharedSubTemps();
+    }
+
+    _colorItr = itrBase + _itr_num;
+
+#ifdef DISTRI
+    // combine the sums of the iterations from all processes
+    if (_itrProcNum > 1)
+    {
+        MPI_Allreduce(MPI_IN_PLACE, &iterCount[0], _templateNum, MPI_DOUBLE, MPI_SUM, _itrComm);
+        MPI_Allreduce(MPI_IN_PLACE, &iterSqCount[0], _templateNum, MPI_DOUBLE, MPI_SUM, _itrComm);
+    }
+#endif
+
+#ifdef VERBOSE
+    printf("Finish counting\n");
+    std::fflush(stdout); 
+#endif
+
+    double totalCountTime = (utility::timer() - timeStart);
+    printf("\nTime for count per iter: %9.6lf seconds\n", totalCountTime/_itr_num);
+    std::fflush(stdout);
+
+#ifdef VERBOSE
+    printf("spmv ratio %f\% \n", 100*(_spmvTime/totalCountTime));
+    std::fflush(stdout);
+    printf("eMA ratio %f\% \n", 100*(_eMATime/totalCountTime));
+    std::fflush(stdout);
+    printf("Peak Mem Usage is : %9.6lf GB\n", _peakMemUsage);
+    std::fflush(stdout);
+
+    printf("SpMM time is : %f second; EMA time is: %f \n", _spmvElapsedTime/_itr_num, _fmaElapsedTime/_itr_num);
+    std::fflush(stdout);
+
+    printf("SpMM Memory bandwidth is : %f GBytes per second\n", (_spmvMemBytes*_itr_num)/_spmvElapsedTime);
+    std::fflush(stdout);
+    printf("FMA Memory bandwidth is : %f GBytes per second\n", (_fmaMemBytes*_itr_num)/_fmaElapsedTime);
+    std::fflush(stdout);
+
+    printf("Total Memory bandwidth is : %f GBytes per second\n", 
+            ((_spmvMemBytes+_fmaMemBytes)*_itr_num)/(_spmvElapsedTime + _fmaElapsedTime));
+    std::fflush(stdout);
+
+    printf("SpMM Throughput is : %f Gflops per second\n", (_spmvFlops*_itr_num)/_spmvElapsedTime);
+    std::fflush(stdout);
+    printf("FMA Throughput is : %f Gflops per second\n", (_fmaFlops*_itr_num)/_fmaElapsedTime);
+    std::fflush(stdout);
+    printf("Total Throughput is : %f Gflops per second\n", 
+            ((_spmvFlops+_fmaFlops)*_itr_num)/(_spmvElapsedTime+_fmaElapsedTime));
+    std::fflush(stdout);
+
+#endif
+
+    // finish counting
+    for (int t = 0; t < _templateNum; ++t) {
+
+        selectTemplate(t);
+
+        if (_templateNum > 1)
+            printf("Template %d\n", t);
+
+        double finalCount = iterCount[t]/(double)_itr_num;
+        double probColorful = factorial(_color_num) / 
+            ( factorial(_color_num - _templates->get_vert_num())*pow(_color_num, _templates->get_vert_num()));
+
+        printf("Final raw count is %e\n", finalCount);
+        std::fflush(stdout);
+
+        printf("Prob is %f\n", probColorful);
+        std::fflush(stdout);
+
+        double automoNum = _calculate_automorphisms ? automorphismNum() : 1.0;  
+
+        // standard error of the mean over iterations
+        if (_itr_num > 1)
+        {
+            double variance = (iterSqCount[t] - iterCount[t]*finalCount)/(_itr_num - 1);
+            double stdError = sqrt(std::max(variance, 0.0)/_itr_num)/(probColorful*automoNum);
+            printf("Standard error of final count is %e\n", stdError);
+            std::fflush(stdout);
+        }
+
+        finalCount = floor(finalCount/(probColorful*automoNum) + 0.5);
+
+        printf("Final count is %e\n", finalCount);
+        std::fflush(stdout);
+
+        finalCounts[t] = finalCount;
+    }
+
+}/*}}}*/
+
+#ifdef DISTRI
+/**
+ * @brief the ranks exchange the halo rows and reduce the counts sub-template 
+ * by sub-template, so they must hold the same division of template t. 
+ * Compares a hash of the sub-template forms and of their main/aux children
+ *
+ * @param t
+ *
+ * @return true if all the ranks have the division of this rank
+ */
+bool CountMat::checkDivisionAcrossRanks(int t)
+{/*{{{*/
+
+    uint64_t hash = 14695981039346656037ULL;
+    int subsNum = _divList[t].get_subtps_num();
+    Graph* subs = _divList[t].get_subtps();
+
+    for (int s = 0; s < subsNum; ++s)
+    {
+        int64_t fields[3] = {subs[s].get_vert_num(), -1, -1};
+        if (subs[s].get_vert_num() > 1)
+        {
+            fields[1] = _divList[t].get_main_node_idx(s);
+            fields[2] = _divList[t].get_aux_node_idx(s);
+        }
+
+        for (int f = 0; f < 3; ++f)
+            hash = (hash ^ (uint64_t)fields[f])*1099511628211ULL;
+
+        // sub-templates of a size differ by their shape
+        string form = _divList[t].get_canonical_form(s);
+        for (size_t c = 0; c < form.size(); ++c)
+            hash = (hash ^ (uint8_t)form[c])*1099511628211ULL;
+    }
+
+    unsigned long long localHash[2] = {hash, ~hash};
+    unsigned long long maxHash[2] = {0, 0};
+    MPI_Allreduce(localHash, maxHash, 2, MPI_UNSIGNED_LONG_LONG, MPI_MAX, _graphDist->getComm());
 
-    _templates = &templates; 
-    _color_num = _templates->get_vert_num();
+    // max of the hash and of its complement, equal only if all the hashes are
+    return (maxHash[0] == localHash[0] && maxHash[1] == localHash[1]);
 
-    div_tp.DivideTp(*(_templates));
-    div_tp.sort_tps();
+}/*}}}*/
+#endif
 
-    _subtmp_array = div_tp.get_subtps();
-    _total_sub_num = div_tp.get_subtps_num();
+void CountMat::prepareTemplate(int t)
+{/*{{{*/
+
+    // partition the pruned template by the modelled SpMM and eMA bytes on this graph
+    if (_isPruned == 1)
+    {
+        double bytesSpmvPer = 0.0;
+        double bytesFMAPer = 0.0;
+        getCommBytesPGBSC(bytesSpmvPer, bytesFMAPer);
+
+#ifdef DISTRI
+        // the bytes of the local rows differ by rank, the model takes the 
+        // whole graph so that all the ranks divide the template alike
+        if (_graphDist != nullptr)
+        {
+            double bytesLocal[2] = {bytesSpmvPer, bytesFMAPer};
+            double bytesGlobal[2] = {0.0, 0.0};
+            MPI_Allreduce(bytesLocal, bytesGlobal, 2, MPI_DOUBLE, MPI_SUM, _graphDist->getComm());
+            bytesSpmvPer = bytesGlobal[0];
+            bytesFMAPer = bytesGlobal[1];
+        }
+#endif
+        _divList[t].set_cost_model(_color_num, bytesSpmvPer, bytesFMAPer);
+    }
+
+    _divList[t].DivideTp(_templateList[t]);
+    _divList[t].sort_tps();
+    _subtmpList[t] = _divList[t].get_subtps();
+
+#ifdef DISTRI
+    if (_graphDist != nullptr && !checkDivisionAcrossRanks(t))
+    {
+        fprintf(stderr, "Rank %d divided template %d unlike the other ranks\n", _graphDist->getRank(), t);
+        MPI_Abort(_graphDist->getComm(), 1);
+    }
+#endif
+
+    selectTemplate(t);
 
 #ifdef VERBOSE
     printSubTemps(); 
 #endif
    
     // create the index tables
-    indexer.initialization(_color_num, _total_sub_num, &_subtmp_array, &div_tp);
+    indexer->initialization(_color_num, _total_sub_num, &(_subtmpList[t]), div_tp);
 
     // check the effective aux indices
     // for (int s = 0; s < _total_sub_num; ++s) {
     //     printf("Effectiv sub %d\n", s);
     //     std::fflush(stdout);
-    //     std::vector<int>* effectVector = indexer.getEffectiveAuxIndices();
+    //     std::vector<int>* effectVector = indexer->getEffectiveAuxIndices();
     //     for (int i = 0; i < effectVector[s].size(); ++i) {
     //         printf("index: %d\n", effectVector[s][i]); 
     //         std::fflush(stdout);
@@ -109,10 +501,10 @@ double CountMat::compute(Graph& templates, bool isEstimate)
     //
     //     if (_subtmp_array[s].get_vert_num() > 1)
     //     {
-    //         int idxAux = div_tp.get_aux_node_idx(s);
-    //         int auxSize = indexer.getSubsSize()[idxAux];
-    //         int auxNodesLen = indexer.getCombTable()[_color_num][auxSize];
-    //         printf("Subs: %d, Aux count len: %d, effect len: %d\n", s, auxNodesLen, (indexer.getEffectiveAuxIndices())[s].size());
+    //         int idxAux = div_tp->get_aux_node_idx(s);
+    //         int auxSize = indexer->getSubsSize()[idxAux];
+    //         int auxNodesLen = indexer->getCombTable()[_color_num][auxSize];
+    //         printf("Subs: %d, Aux count len: %d, effect len: %d\n", s, auxNodesLen, (indexer->getEffectiveAuxIndices())[s].size());
     //         std::fflush(stdout);
     //     }
     // }
@@ -122,7 +514,7 @@ double CountMat::compute(Graph& templates, bool isEstimate)
     std::fflush(stdout); 
 #endif
 
-    _dTable.initDataTable(_subtmp_array, &indexer, _total_sub_num, _color_num, _vert_num, _thd_num, _useSPMM, _bufMatCols);
+    _dTable->initDataTable(_subtmp_array, indexer, _total_sub_num, _color_num, _vert_num, _thd_num, _useSPMM, _bufMatCols);
 
 #ifdef VERBOSE
     printf("Finish initializaing datatable\n");
@@ -161,130 +553,360 @@ double CountMat::compute(Graph& templates, bool isEstimate)
 
 #endif 
 
-    // exit without counting
-    if (isEstimate)
-        return 0.0;
+}/*}}}*/
+
+void CountMat::selectTemplate(int t)
+{
+    _curTemplate = t;
+    _templates = &(_templateList[t]);
+    div_tp = &(_divList[t]);
+    indexer = &(_indexerList[t]);
+    _dTable = &(_dTableList[t]);
+
+    _subtmp_array = _subtmpList[t];
+    _total_sub_num = div_tp->get_subtps_num();
+    _subScale.assign(_total_sub_num, 1.0);
+}
+
+/**
+ * @brief Plan the re-use of sub-template tables across templates 
+ * counted on the same coloring. The count table of a rooted sub-template 
+ * only depends on its canonical form, hence a table computed for one template 
+ * is kept in _sharedTables and linked by the later templates, whose sub-trees
+ * below a linked sub-template are skipped. Aux tables are overwritten by SpMV in 
+ * the pruned algorithm, so they are either copied from a cached raw table or 
+ * linked to a cached table with SpMV already applied.
+ */
+void CountMat::planSharedSubTemps()
+{/*{{{*/
+
+    // the (template, sub) that computes a cached table
+    // keys are canonical forms, appended by "*" for aux tables after SpMV
+    std::map<string, std::pair<int, int> > producers;
+
+    _shareAction = new std::vector<int>[_templateNum];
+    _shareFlags = new std::vector<int>[_templateNum];
+    _subCanon = new std::vector<string>[_templateNum];
+
+    int linkNum = 0;
+    int skipNum = 0;
+
+    for (int t = 0; t < _templateNum; ++t) 
+    {
+        DivideTemplates* divLocal = &(_divList[t]);
+        Graph* subsLocal = _subtmpList[t];
+        int subNum = divLocal->get_subtps_num();
+
+        std::vector<int>& action = _shareAction[t];
+        action.assign(subNum, SHARE_SKIP);
+        _shareFlags[t].assign(subNum, 0);
+
+        for (int s = 0; s < subNum; ++s) {
+            _subCanon[t].push_back(divLocal->get_canonical_form(s));
+            if (subsLocal[s].get_vert_num() > 1)
+                _shareFlags[t][divLocal->get_aux_node_idx(s)] |= SHARE_AUX;
+        }
+
+        action[0] = SHARE_COMPUTE;
+        // the bottom table backs all of the leaves
+        if (subsLocal[subNum-1].get_vert_num() == 1)
+            action[subNum-1] = SHARE_COMPUTE;
+
+        // parents are placed before children after sort_tps
+        for (int s = 0; s < subNum; ++s) 
+        {
+            if (action[s] != SHARE_COMPUTE || subsLocal[s].get_vert_num() == 1)
+                continue;
+
+            int childs[2] = {divLocal->get_main_node_idx(s), divLocal->get_aux_node_idx(s)};
+            for (int c = 0; c < 2; ++c) 
+            {
+                int child = childs[c];
+                string key = _subCanon[t][child];
+
+                std::map<string, std::pair<int, int> >::iterator itrSpmv = producers.find(key + "*");
+                std::map<string, std::pair<int, int> >::iterator itrRaw = producers.find(key);
+
+                if (subsLocal[child].get_vert_num() == 1)
+                    action[child] = SHARE_COMPUTE;
+                else if (c == 1 && _isPruned == 1 && itrSpmv != producers.end())
+                {
+                    action[child] = SHARE_LINK_SPMV;
+                    _shareFlags[itrSpmv->second.first][itrSpmv->second.second] |= SHARE_KEEP_SPMV;
+                }
+                else if (itrRaw != producers.end())
+                {
+                    action[child] = (c == 1 && _isPruned == 1) ? SHARE_COPY : SHARE_LINK;
+                    _shareFlags[itrRaw->second.first][itrRaw->second.second] |= SHARE_KEEP_RAW;
+                }
+                else
+                    action[child] = SHARE_COMPUTE;
+            }
+        }
+
+        // alias the isomorphic sub-templates within this template
+        planLocalSubTemps(t);
+
+        std::vector<int> parents;
+        std::vector<bool> isReached;
+        getSubParents(t, parents);
+        markReachedSubTemps(t, isReached);
+
+        // register the tables produced by this template
+        for (int s = 1; s < subNum; ++s) 
+        {
+            if (subsLocal[s].get_vert_num() == 1)
+                continue;
+
+            string key = _subCanon[t][s];
+
+            if (action[s] == SHARE_COMPUTE && producers.find(key) == producers.end())
+                producers[key] = std::make_pair(t, findRawProducer(t, key, isReached));
+
+            if ((_shareFlags[t][s] & SHARE_AUX) && _isPruned == 1 && (action[s] == SHARE_COMPUTE || action[s] == SHARE_COPY) 
+                    && producers.find(key + "*") == producers.end())
+                producers[key + "*"] = std::make_pair(t, findSpmvProducer(t, key, parents, isReached));
+
+            if (action[s] == SHARE_SKIP)
+                skipNum++;
+            else if (action[s] != SHARE_COMPUTE)
+                linkNum++;
+        }
+    }
 
 #ifdef VERBOSE
-    printf("Start counting\n");
-    std::fflush(stdout); 
+    printf("Shared sub-templates: linked %d, skipped %d\n", linkNum, skipNum);
+    std::fflush(stdout);
 #endif
 
-    // allocating the bufVecLeaf buffer
-    _bufVecLeaf = (float**) malloc (_color_num*sizeof(float*));
-    if (_useSPMM == 0)
+}/*}}}*/
+
+/**
+ * @brief alias the tables of isomorphic sub-templates within template t.
+ * Sub-templates are visited parents first, each one is linked to the 
+ * table of an isomorphic sub-template computed before it and its own 
+ * subtree is skipped. A link is kept only if all of the linked 
+ * sub-templates still have a producer computed ahead of them.
+ *
+ * @param t
+ */
+void CountMat::planLocalSubTemps(int t)
+{/*{{{*/
+
+    Graph* subsLocal = _subtmpList[t];
+    int subNum = _divList[t].get_subtps_num();
+    std::vector<int>& action = _shareAction[t];
+
+    std::vector<int> parents;
+    std::vector<bool> isReached;
+    std::vector<bool> isLocal(subNum, false);
+    getSubParents(t, parents);
+
+    for (int s = 1; s < subNum; ++s) 
     {
-        for (int i = 0; i < _color_num; ++i) {
-#ifdef __INTEL_COMPILER
-            _bufVecLeaf[i] =  (float*) _mm_malloc(_vert_num*sizeof(float), 64); 
-#else
-            _bufVecLeaf[i] =  (float*) aligned_alloc(64, _vert_num*sizeof(float)); 
-#endif 
+        markReachedSubTemps(t, isReached);
+        if (!isReached[s] || action[s] != SHARE_COMPUTE || subsLocal[s].get_vert_num() == 1)
+            continue;
+
+        // a pruned aux table after SpMV saves the SpMV as well
+        bool isPrunedAux = ((_shareFlags[t][s] & SHARE_AUX) && _isPruned == 1);
+        int candidates[2] = {SHARE_LINK_SPMV, isPrunedAux ? SHARE_COPY : SHARE_LINK};
+
+        for (int c = (isPrunedAux ? 0 : 1); c < 2; ++c) 
+        {
+            action[s] = candidates[c];
+            isLocal[s] = true;
+            if (isLocalPlanValid(t, parents, isLocal))
+                break;
+
+            action[s] = SHARE_COMPUTE;
+            isLocal[s] = false;
         }
+    }
 
+    // skip the subtrees of linked sub-templates and flag the producers
+    markReachedSubTemps(t, isReached);
+    for (int s = 1; s < subNum; ++s) 
+    {
+        if (subsLocal[s].get_vert_num() == 1)
+            continue;
+
+        if (!isReached[s])
+            action[s] = SHARE_SKIP;
+        else if (isLocal[s] && action[s] == SHARE_LINK_SPMV)
+            _shareFlags[t][findSpmvProducer(t, _subCanon[t][s], parents, isReached)] |= SHARE_KEEP_SPMV;
+        else if (isLocal[s])
+            _shareFlags[t][findRawProducer(t, _subCanon[t][s], isReached)] |= SHARE_KEEP_RAW;
     }
-    else
+
+}/*}}}*/
+
+bool CountMat::isLocalPlanValid(int t, std::vector<int>& parents, std::vector<bool>& isLocal)
+{
+    std::vector<bool> isReached;
+    markReachedSubTemps(t, isReached);
+
+    for (int s = 1; s < _divList[t].get_subtps_num(); ++s) 
     {
-#ifdef __INTEL_COMPILER
-        _bufVecLeaf[0] =  (float*) _mm_malloc((int64_t)(_vert_num)*_color_num*sizeof(float), 64); 
-#else
-        _bufVecLeaf[0] =  (float*) aligned_alloc(64, (int64_t)(_vert_num)*_color_num*sizeof(float)); 
-#endif 
+        if (!isReached[s] || !isLocal[s])
+            continue;
 
-        for (int i = 1; i < _color_num; ++i) {
-           _bufVecLeaf[i] = _bufVecLeaf[0] + i*_vert_num; 
+        // the producer must be computed before s is used
+        if (_shareAction[t][s] == SHARE_LINK_SPMV)
+        {
+            int producer = findSpmvProducer(t, _subCanon[t][s], parents, isReached);
+            if (producer < 0 || parents[producer] <= parents[s])
+                return false;
         }
+        else if (findRawProducer(t, _subCanon[t][s], isReached) <= s)
+            return false;
     }
 
-    // start counting
-    double timeStart = utility::timer();
+    return true;
+}
 
-    double iterCount = 0.0;
-    for (int i = 0; i < _itr_num; ++i) {
-        iterCount += colorCounting();
+void CountMat::markReachedSubTemps(int t, std::vector<bool>& isReached)
+{
+    int subNum = _divList[t].get_subtps_num();
+    isReached.assign(subNum, false);
+    isReached[0] = true;
+
+    for (int s = 0; s < subNum; ++s) 
+    {
+        if (isReached[s] && _shareAction[t][s] == SHARE_COMPUTE && _subtmpList[t][s].get_vert_num() > 1)
+        {
+            isReached[_divList[t].get_main_node_idx(s)] = true;
+            isReached[_divList[t].get_aux_node_idx(s)] = true;
+        }
     }
+}
 
-#ifdef VERBOSE
-    printf("Finish counting\n");
-    std::fflush(stdout); 
-#endif
+void CountMat::getSubParents(int t, std::vector<int>& parents)
+{
+    int subNum = _divList[t].get_subtps_num();
+    parents.assign(subNum, -1);
 
-    double totalCountTime = (utility::timer() - timeStart);
-    printf("\nTime for count per iter: %9.6lf seconds\n", totalCountTime/_itr_num);
-    std::fflush(stdout);
+    for (int s = 0; s < subNum; ++s) 
+    {
+        if (_subtmpList[t][s].get_vert_num() > 1)
+        {
+            parents[_divList[t].get_main_node_idx(s)] = s;
+            parents[_divList[t].get_aux_node_idx(s)] = s;
+        }
+    }
+}
 
-#ifdef VERBOSE
-    printf("spmv ratio %f\% \n", 100*(_spmvTime/totalCountTime));
-    std::fflush(stdout);
-    printf("eMA ratio %f\% \n", 100*(_eMATime/totalCountTime));
-    std::fflush(stdout);
-    printf("Peak Mem Usage is : %9.6lf GB\n", _peakMemUsage);
-    std::fflush(stdout);
+/**
+ * @brief the first computed (largest index) sub-template of template t
+ * with canonical form key, -1 if none
+ */
+int CountMat::findRawProducer(int t, string& key, std::vector<bool>& isReached)
+{
+    for (int s = _divList[t].get_subtps_num() - 1; s > 0; --s) 
+    {
+        if (isReached[s] && _shareAction[t][s] == SHARE_COMPUTE && _subtmpList[t][s].get_vert_num() > 1 
+                && _subCanon[t][s] == key)
+            return s;
+    }
 
-    printf("SpMM time is : %f second; EMA time is: %f \n", _spmvElapsedTime/_itr_num, _fmaElapsedTime/_itr_num);
-    std::fflush(stdout);
+    return -1;
+}
 
-    printf("SpMM Memory bandwidth is : %f GBytes per second\n", (_spmvMemBytes*_itr_num)/_spmvElapsedTime);
-    std::fflush(stdout);
-    printf("FMA Memory bandwidth is : %f GBytes per second\n", (_fmaMemBytes*_itr_num)/_fmaElapsedTime);
-    std::fflush(stdout);
+/**
+ * @brief the pruned aux sub-template of template t with canonical form key, 
+ * whose SpMV is applied first (parent of largest index), -1 if none
+ */
+int CountMat::findSpmvProducer(int t, string& key, std::vector<int>& parents, std::vector<bool>& isReached)
+{
+    int producer = -1;
+    for (int s = 1; s < _divList[t].get_subtps_num(); ++s) 
+    {
+        if (isReached[s] && (_shareFlags[t][s] & SHARE_AUX) && _subtmpList[t][s].get_vert_num() > 1 
+                && (_shareAction[t][s] == SHARE_COMPUTE || _shareAction[t][s] == SHARE_COPY)
+                && _subCanon[t][s] == key && (producer < 0 || parents[s] > parents[producer]))
+            producer = s;
+    }
 
-    printf("Total Memory bandwidth is : %f GBytes per second\n", 
-            ((_spmvMemBytes+_fmaMemBytes)*_itr_num)/(_spmvElapsedTime + _fmaElapsedTime));
-    std::fflush(stdout);
+    return producer;
+}
 
-    printf("SpMM Throughput is : %f Gflops per second\n", (_spmvFlops*_itr_num)/_spmvElapsedTime);
-    std::fflush(stdout);
-    printf("FMA Throughput is : %f Gflops per second\n", (_fmaFlops*_itr_num)/_fmaElapsedTime);
-    std::fflush(stdout);
-    printf("Total Throughput is : %f Gflops per second\n", 
-            ((_spmvFlops+_fmaFlops)*_itr_num)/(_spmvElapsedTime+_fmaElapsedTime));
-    std::fflush(stdout);
+void CountMat::linkSharedSubTemp(int subsId)
+{
+    string key = _subCanon[_curTemplate][subsId];
+    if (_shareAction[_curTemplate][subsId] == SHARE_LINK_SPMV)
+        key += "*";
 
-#endif
+    SharedTable& entry = _sharedTables[key];
 
-    // finish counting
-    double finalCount = iterCount/(double)_itr_num;
-    double probColorful = factorial(_color_num) / 
-                ( factorial(_color_num - _templates->get_vert_num())*pow(_color_num, _templates->get_vert_num()));
+    if (_shareAction[_curTemplate][subsId] == SHARE_COPY)
+        _dTable->copySubTempTable(subsId, entry.table);
+    else
+        _dTable->linkSubTempTable(subsId, entry.table);
 
-    printf("Final raw count is %e\n", finalCount);
-    std::fflush(stdout);
+    _subScale[subsId] = entry.scale;
+}
 
-    printf("Prob is %f\n", probColorful);
-    std::fflush(stdout);
+void CountMat::keepSharedSubTemp(int subsId, bool isSpmv)
+{
+    string key = _subCanon[_curTemplate][subsId];
+    if (isSpmv)
+        key += "*";
 
-    // int automoNum = 1;
-    int automoNum = _calculate_automorphisms ? automorphismNum() : 1;  
-    finalCount = floor(finalCount/(probColorful*(double)automoNum) + 0.5);
+    SharedTable entry;
+    entry.len = _dTable->getTableLen(subsId);
+    entry.scale = _subScale[subsId];
+    entry.table = _dTable->detachSubTempTable(subsId);
 
-    printf("Final count is %e\n", finalCount);
-    std::fflush(stdout);
+    _sharedTables[key] = entry;
+}
 
-    return finalCount;
+void CountMat::releaseSharedSubTemps()
+{
+    std::map<string, SharedTable>::iterator itr;
+    for (itr = _sharedTables.begin(); itr != _sharedTables.end(); ++itr) {
+        _dTableList[0].freeTableArray(itr->second.table, itr->second.len);
+    }
 
-}/*}}}*/
+    _sharedTables.clear();
+}
 
 double CountMat::colorCounting()
 {/*{{{*/
 
-    colorInit();
-
     double countTotal = 0.0;
     // reset scaling flag
     _isScaled = 0;
 
     for (int s = _total_sub_num - 1; s >= 0; --s) {
 
+        int shareAction = _shareAction[_curTemplate][s];
+        int shareFlags = _shareFlags[_curTemplate][s];
+
+        if (shareAction == SHARE_SKIP)
+            continue;
+
+        // the table is taken from a sub-template counted earlier on this coloring 
+        // right before it is used
+        if (shareAction != SHARE_COMPUTE)
+            continue;
+
         int subSize = _subtmp_array[s].get_vert_num();
-        int mainIdx = div_tp.get_main_node_idx(s);
-        int auxIdx = div_tp.get_aux_node_idx(s);
+        int mainIdx = div_tp->get_main_node_idx(s);
+        int auxIdx = div_tp->get_aux_node_idx(s);
+
+        if (subSize > 1)
+        {
+            if (_shareAction[_curTemplate][mainIdx] != SHARE_COMPUTE)
+                linkSharedSubTemp(mainIdx);
+            if (_shareAction[_curTemplate][auxIdx] != SHARE_COMPUTE)
+                linkSharedSubTemp(auxIdx);
+        }
 
-        _dTable.initSubTempTable(s, mainIdx, auxIdx);
-        int* idxCombToCount = (indexer.getSubCToCount())[s]; 
+        _dTable->initSubTempTable(s, mainIdx, auxIdx);
+        int* idxCombToCount = (indexer->getSubCToCount())[s]; 
 
         if (subSize == 1) {
-            _dTable.countCurBottom(idxCombToCount, _colors_local);          
+            _dTable->countCurBottom(idxCombToCount, _colors_local);          
         }
         else
         {
@@ -310,10 +932,26 @@ double CountMat::colorCounting()
         std::fflush(stdout);
         _peakMemUsage = (compute_mem > _peakMemUsage) ? compute_mem : _peakMemUsage;
 
+        if (shareFlags & SHARE_KEEP_RAW)
+        {
+            // keep the raw table before it is consumed, 
+            // an aux table gets a private copy to be overwritten by SpMV
+            keepSharedSubTemp(s, false);
+            if (_isPruned == 1 && (shareFlags & SHARE_AUX))
+                _dTable->copySubTempTable(s, _sharedTables[_subCanon[_curTemplate][s]].table);
+            else
+                _dTable->linkSubTempTable(s, _sharedTables[_subCanon[_curTemplate][s]].table);
+        }
+
         if (mainIdx != DUMMY_VAL)
-            _dTable.cleanSubTempTable(mainIdx, false);
+            _dTable->cleanSubTempTable(mainIdx, false);
         if (auxIdx != DUMMY_VAL)
-            _dTable.cleanSubTempTable(auxIdx, false);
+        {
+            if (_shareFlags[_curTemplate][auxIdx] & SHARE_KEEP_SPMV)
+                keepSharedSubTemp(auxIdx, true);
+            else
+                _dTable->cleanSubTempTable(auxIdx, false);
+        }
     }
 
     return countTotal;
@@ -338,15 +976,15 @@ double CountMat::countNonBottomePruned(int subsId)
 
     int subSize = _subtmp_array[subsId].get_vert_num();
 
-    int idxMain = div_tp.get_main_node_idx(subsId);
-    int idxAux = div_tp.get_aux_node_idx(subsId);
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int idxAux = div_tp->get_aux_node_idx(subsId);
 
-    int mainSize = indexer.getSubsSize()[idxMain];
-    int auxSize = indexer.getSubsSize()[idxAux];
+    int mainSize = indexer->getSubsSize()[idxMain];
+    int auxSize = indexer->getSubsSize()[idxAux];
    
-    int countCombNum = indexer.getCombTable()[_color_num][subSize];
-    int splitCombNum = indexer.getCombTable()[subSize][mainSize];
-    int auxTableLen = indexer.getCombTable()[_color_num][auxSize];
+    int countCombNum = indexer->getCombTable()[_color_num][subSize];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
+    int auxTableLen = indexer->getCombTable()[_color_num][auxSize];
 
 #ifdef VERBOSE
     printf("Finish init sub templte %d, vert: %d, comb: %d, splitNum: %d, spmv times: %d, isScaled: %d\n", subsId, subSize, 
@@ -354,11 +992,21 @@ double CountMat::countNonBottomePruned(int subsId)
     std::fflush(stdout); 
 #endif
 
+    // tables linked from another template may be scaled down already
+    double inScale = _subScale[idxMain]*_subScale[idxAux];
+    if (inScale != 1.0)
+        _isScaled = 1;
+
+    _subScale[subsId] = (subsId > 0 && _isScaled == 0) ? 1.0e-12*inScale : inScale;
+
+    // an aux table linked from another template already holds the SpMV results 
+    bool isAuxSpmvDone = (_shareAction[_curTemplate][idxAux] == SHARE_LINK_SPMV);
+
     double countSum = 0.0;
     double subSum = 0.0;
-    int** mainSplitLocal = (indexer.getSplitToCountTable())[0][subsId]; 
-    int** auxSplitLocal = (indexer.getSplitToCountTable())[1][subsId]; 
-    int* combToCountLocal = (indexer.getCombToCountTable())[subsId];
+    int** mainSplitLocal = (indexer->getSplitToCountTable())[0][subsId]; 
+    int** auxSplitLocal = (indexer->getSplitToCountTable())[1][subsId]; 
+    int* combToCountLocal = (indexer->getCombToCountTable())[subsId];
 
     double* bufLastSub = nullptr;
     float* objArray = nullptr;
@@ -398,9 +1046,9 @@ double CountMat::countNonBottomePruned(int subsId)
        _graph->SpMVMKLHint(auxTableLen);
    }
 
-   for (int i = 0; i < auxTableLen; ++i) {
+   for (int i = 0; i < auxTableLen && !isAuxSpmvDone; ++i) {
 
-       float* auxObjArray = _dTable.getAuxArray(i);
+       float* auxObjArray = _dTable->getAuxArray(i);
 
 #ifdef VERBOSE
        spmvStart = utility::timer();
@@ -416,7 +1064,7 @@ double CountMat::countNonBottomePruned(int subsId)
            }
            else
            {
-               _graph->SpMVNaiveFull(auxObjArray, _bufVec, _thd_num); 
+               _graph->SpMVMergePath(auxObjArray, _bufVec, _thd_num); 
            }
        }
        else
@@ -428,7 +1076,7 @@ double CountMat::countNonBottomePruned(int subsId)
                _bufVec[j] = 0.0;    
            }
 
-           _graphCSC->spmvNaiveSplit(auxObjArray, _bufVec, _thd_num);
+           multiplyCSC(auxObjArray, _bufVec, 0);
        }
            
 #ifdef VERBOSE
@@ -459,7 +1107,7 @@ double CountMat::countNonBottomePruned(int subsId)
 // #endif
 
         if (subsId > 0)
-            objArray = _dTable.getCurTableArray(combIdx);
+            objArray = _dTable->getCurTableArray(combIdx);
 
         for (int j = 0; j < splitCombNum; ++j) {
 
@@ -474,12 +1122,12 @@ double CountMat::countNonBottomePruned(int subsId)
             // already pre-computed by SpMV
             float* auxArraySelect = nullptr;
             if (auxSize > 1)
-                auxArraySelect = _dTable.getAuxArray(auxIdx);
+                auxArraySelect = _dTable->getAuxArray(auxIdx);
             else
                 auxArraySelect = _bufVecLeaf[auxIdx];
 
             // element-wise mul 
-            float* mainArraySelect = _dTable.getMainArray(mainIdx);
+            float* mainArraySelect = _dTable->getMainArray(mainIdx);
 
             #ifdef VERBOSE
                 fmaStart = utility::timer();
@@ -488,17 +1136,17 @@ double CountMat::countNonBottomePruned(int subsId)
             if (subsId > 0)
             {
                 if (_isScaled == 0)
-                    _dTable.arrayWiseFMAScale(objArray, auxArraySelect, mainArraySelect, 1.0e-12);
+                    _dTable->arrayWiseFMAScale(objArray, auxArraySelect, mainArraySelect, 1.0e-12);
                 else
                 {
-                    _dTable.arrayWiseFMAAVX(objArray, auxArraySelect, mainArraySelect);
-                    // _dTable.arrayWiseFMA(objArray, auxArraySelect, mainArraySelect);
+                    _dTable->arrayWiseFMAAVX(objArray, auxArraySelect, mainArraySelect);
+                    // _dTable->arrayWiseFMA(objArray, auxArraySelect, mainArraySelect);
                 }
             }
             else
             {
                 // the last scale use 
-                _dTable.arrayWiseFMALast(bufLastSub, auxArraySelect, mainArraySelect);
+                _dTable->arrayWiseFMALast(bufLastSub, auxArraySelect, mainArraySelect);
             }
 
             #ifdef VERBOSE
@@ -525,8 +1173,7 @@ double CountMat::countNonBottomePruned(int subsId)
         }
 
         // to recover the scale down process
-        if (_isScaled == 1)
-            countSum *= 1.0e+12;
+        countSum /= _subScale[subsId];
 
 #ifdef __INTEL_COMPILER
         _mm_free(bufLastSub);
@@ -569,30 +1216,35 @@ double CountMat::countNonBottomePrunedSPMM(int subsId)
 
     int subSize = _subtmp_array[subsId].get_vert_num();
 
-    int idxMain = div_tp.get_main_node_idx(subsId);
-    int idxAux = div_tp.get_aux_node_idx(subsId);
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int idxAux = div_tp->get_aux_node_idx(subsId);
 
-    int mainSize = indexer.getSubsSize()[idxMain];
-    int auxSize = indexer.getSubsSize()[idxAux];
+    int auxSize = indexer->getSubsSize()[idxAux];
    
-    int countCombNum = indexer.getCombTable()[_color_num][subSize];
-    int splitCombNum = indexer.getCombTable()[subSize][mainSize];
-    int auxTableLen = indexer.getCombTable()[_color_num][auxSize];
+    int countCombNum = indexer->getCombTable()[_color_num][subSize];
+    int auxTableLen = indexer->getCombTable()[_color_num][auxSize];
 
 #ifdef VERBOSE
+    int mainSize = indexer->getSubsSize()[idxMain];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
     printf("Finish init sub templte %d, vert: %d, comb: %d, splitNum: %d, isScaled: %d\n", subsId, subSize, 
             countCombNum, splitCombNum, _isScaled);
     std::fflush(stdout); 
 #endif
 
+    // tables linked from another template may be scaled down already
+    double inScale = _subScale[idxMain]*_subScale[idxAux];
+    if (inScale != 1.0)
+        _isScaled = 1;
+
+    _subScale[subsId] = (subsId > 0 && _isScaled == 0) ? 1.0e-12*inScale : inScale;
+
+    // an aux table linked from another template already holds the SpMV results 
+    bool isAuxSpmvDone = (_shareAction[_curTemplate][idxAux] == SHARE_LINK_SPMV);
+
     double countSum = 0.0;
     double subSum = 0.0;
-    int** mainSplitLocal = (indexer.getSplitToCountTable())[0][subsId]; 
-    int** auxSplitLocal = (indexer.getSplitToCountTable())[1][subsId]; 
-    int* combToCountLocal = (indexer.getCombToCountTable())[subsId];
-
     double* bufLastSub = nullptr;
-    float* objArray = nullptr;
 
     if (subsId == 0)
     {
@@ -616,237 +1268,527 @@ double CountMat::countNonBottomePrunedSPMM(int subsId)
     double eltMul = 0.0;
 #endif
     double spmvStart = 0.0;
-    double fmaStart = 0.0;
 
 // first the precompute of SPMM results and have a in-place storage
 #ifdef VERBOSE
    startTimeComp = utility::timer(); 
 #endif
 
+   // the eMA of each batch overlaps the halo exchange of the next one
+   bool isPipelined = false;
+#ifdef DISTRI
+   isPipelined = (!isAuxSpmvDone && _graphDist != nullptr && _graphDist->hasHalo());
+#endif
+
+   // the SpMM outputs are consumed by batches instead of overwriting the aux table, 
+   // unless the table is kept for another sub-template
+   bool isStreamed = (_useStream == 1 && !isAuxSpmvDone && !isPipelined && _graph == nullptr 
+           && !(_shareFlags[_curTemplate][idxAux] & SHARE_KEEP_SPMV));
+
    // ---- start of SpMM impl -------
-   if (_graph != nullptr) 
+   if (isAuxSpmvDone)
+   {
+       // nothing to compute
+   }
+#ifdef DISTRI
+   else if (isPipelined)
+   {
+       spmmPipelined(subsId, auxSize, auxTableLen, bufLastSub);
+   }
+#endif
+   else if (_graph != nullptr) 
    {
 
 #ifndef NEC
-       // CSR MKL SpMM implementation 
-       int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
-       int colStart = 0;
+       if (_graph->useMKL())
+       {
+           // CSR MKL SpMM implementation 
+           int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
+           int colStart = 0;
 
-       char transa = 'n';
-       MKL_INT m = _vert_num;
-       MKL_INT n = 0;
-       MKL_INT k = _vert_num;
+           char transa = 'n';
+           MKL_INT m = _vert_num;
+           MKL_INT n = 0;
+           MKL_INT k = _vert_num;
 
-       float alpha = 1.0;
-       float beta = 0.0;
+           float alpha = 1.0;
+           float beta = 0.0;
 
-       char matdescra[5];
-       matdescra[0] = 'g';
-       matdescra[3] = 'f'; /*one-based indexing is used*/
+           char matdescra[5];
+           matdescra[0] = 'g';
+           matdescra[3] = 'f'; /*one-based indexing is used*/
 
-       float* csrVals = _graph->getNNZVal();
-       int* csrRowIdx = _graph->getIndexRow();
-       int* csrColIdx = _graph->getIndexCol();
+           float* csrVals = _graph->getNNZVal();
+           int* csrRowIdx = _graph->getIndexRow();
+           int* csrColIdx = _graph->getIndexCol();
 
+           mkl_set_num_threads(_thd_num);
+           for (int i = 0; i < batchNum; ++i) 
+           {
 
+               int batchSize = (i < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
+               n = batchSize;
 
-       mkl_set_num_threads(_thd_num);
-       for (int i = 0; i < batchNum; ++i) 
+#ifdef VERBOSE
+           spmvStart = utility::timer();
+#endif
+               // invoke the mkl scsrmm kernel
+               mkl_scsrmm(&transa, &m, &n, &k, &alpha, matdescra, csrVals, csrColIdx, csrRowIdx, &(csrRowIdx[1]), _dTable->getAuxArray(colStart), &k, &beta, _bufMatY, &k);
+
+#ifdef VERBOSE
+           _spmvElapsedTime += (utility::timer() - spmvStart);
+#endif
+
+               // copy columns from _bufMatY
+               if (auxSize > 1)
+               {
+                   std::memcpy(_dTable->getAuxArray(colStart), _bufMatY, (int64_t)_vert_num*batchSize*sizeof(float));
+               }
+               else
+               {
+                   std::memcpy(_bufVecLeaf[colStart], _bufMatY, (int64_t)_vert_num*batchSize*sizeof(float));
+               }
+
+               // increase colStart;
+               colStart += batchSize;
+           }
+       }
+       else
+#endif
        {
+           // native CSR SpMM, pulls rows of x into registers
+           int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
+           int colStart = 0;
+
+           for (int i = 0; i < batchNum; ++i) 
+           {
+               int batchSize = (i < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
+
+               valType* xInput = _dTable->getAuxArray(colStart);
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+               for (int j = 0; j <_vert_num; ++j) 
+               {
+                   for (int k = 0; k < batchSize; ++k) {
+                       _bufMatX[(int64_t)j*batchSize+k] = xInput[(int64_t)k*_vert_num+j];
+                   }
+               }
+
+#ifdef VERBOSE
+               spmvStart = utility::timer();
+#endif
+               _graph->SpMMMergePath(_bufMatX, _bufMatY, batchSize, _thd_num);
+#ifdef VERBOSE
+               _spmvElapsedTime += (utility::timer() - spmvStart);
+#endif
+
+               valType* yOutput = (auxSize > 1) ? _dTable->getAuxArray(colStart) : _bufVecLeaf[colStart];
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+               for (int j = 0; j < _vert_num; ++j) {
+                   for (int k = 0; k < batchSize; ++k) {
+                       yOutput[(int64_t)k*_vert_num+j] = _bufMatY[(int64_t)j*batchSize+k];
+                   }
+               }
+
+               colStart += batchSize;
+           }
+       }
+   }
+   else
+   {
+       // CSC-Split SpMM impl
+       int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
+       int colStart = 0;
 
+       std::vector<std::vector<std::pair<int, int> > > auxConsumers;
+       if (isStreamed)
+           getAuxConsumers(subsId, auxConsumers);
+
+       for (int i = 0; i < batchNum; ++i) 
+       {
            int batchSize = (i < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
-           n = batchSize;
 
+           valType* xInput = _dTable->getAuxArray(colStart);
+
+           // convert data structre from column-majored to row-majored
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int j = 0; j <_vert_num; ++j) 
+    {
+        for (int k = 0; k < batchSize; ++k) {
+            _bufMatX[(int64_t)j*batchSize+k] = xInput[(int64_t)k*_vert_num+j];
+        }
+    }
+           // clean yOuput
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int64_t j = 0; j < (int64_t)_vert_num*batchSize; ++j) {
+        _bufMatY[j] = 0.0; 
+    }
+           
 #ifdef VERBOSE
        spmvStart = utility::timer();
 #endif
-           // invoke the mkl scsrmm kernel
-           mkl_scsrmm(&transa, &m, &n, &k, &alpha, matdescra, csrVals, csrColIdx, csrRowIdx, &(csrRowIdx[1]), _dTable.getAuxArray(colStart), &k, &beta, _bufMatY, &k);
+           // invoke the spmm kernel
+#ifdef DISTRI
+           if (_graphDist != nullptr)
+               _graphDist->spmmSplit(_bufMatX, _bufMatY, batchSize, _thd_num);
+           else
+#endif
+           multiplyCSC(_bufMatX, _bufMatY, batchSize);
 
 #ifdef VERBOSE
        _spmvElapsedTime += (utility::timer() - spmvStart);
 #endif
 
-           // copy columns from _bufMatY
-           if (auxSize > 1)
+           // convert data structure back to column-majored
+           if (isStreamed)
            {
-               std::memcpy(_dTable.getAuxArray(colStart), _bufMatY, _vert_num*batchSize*sizeof(float));
+               // aligned columns in _bufMatX, retired after the eMA of the batch
+               int colStride = ((_vert_num + 15)/16)*16;
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int j = 0; j < _vert_num; ++j) {
+        for (int k = 0; k < batchSize; ++k) {
+            _bufMatX[(int64_t)k*colStride+j] = _bufMatY[(int64_t)j*batchSize+k];
+        }
+    }
+               multiplyAuxBatch(subsId, colStart, batchSize, colStride, auxConsumers, bufLastSub);
            }
            else
            {
-               std::memcpy(_bufVecLeaf[colStart], _bufMatY, _vert_num*batchSize*sizeof(float));
+           valType* yOutput = (auxSize > 1) ? _dTable->getAuxArray(colStart) : _bufVecLeaf[colStart];
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int j = 0; j < _vert_num; ++j) {
+        for (int k = 0; k < batchSize; ++k) {
+            yOutput[(int64_t)k*_vert_num+j] = _bufMatY[(int64_t)j*batchSize+k];
+        }
+    }
            }
 
            // increase colStart;
            colStart += batchSize;
        }
+   }
+
+#ifdef VERBOSE
+   eltSpmv += (utility::timer() - startTimeComp); 
+#endif   
 
+#ifdef VERBOSE
+   startTimeComp = utility::timer(); 
 #endif
-   }
-   else
-   {
-       // CSC-Split SpMM impl
-       int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
-       int colStart = 0;
 
-       for (int i = 0; i < batchNum; ++i) 
-       {
-           int batchSize = (i < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
+// a second part only involves element-wise multiplication and updating
+    if (!isPipelined && !isStreamed)
+    {
+        for(int i=0; i<countCombNum; i++)
+            multiplyComb(subsId, i, auxSize, bufLastSub);
+    }
+
+#ifdef VERBOSE
+   eltMul += (utility::timer() - startTimeComp); 
+#endif
+
+    _isScaled = 1;
+
+    if (subsId == 0)
+    {
+        // sum the vals from bufLastSub  
+        for (int k = 0; k < _vert_num; ++k) {
+            countSum += bufLastSub[k];
+        }
+
+#ifdef DISTRI
+        // sum up the counts of vertices on all ranks
+        if (_graphDist != nullptr)
+            countSum = _graphDist->allReduceSum(countSum);
+#endif
+
+        // to recover the scale down process
+        countSum /= _subScale[subsId];
+
+#ifdef __INTEL_COMPILER
+        _mm_free(bufLastSub);
+#else
+        free(bufLastSub);
+#endif
+    }
+
+#ifdef VERBOSE
+    double subsTime = (utility::timer() - startTime);
+    printf("Sub %d, counting time %f, Spmv time %f: ratio: %f\%,  Mul time %f: ratio: %f\% \n", subsId, subsTime, eltSpmv, 100*(eltSpmv/subsTime), eltMul, 100*(eltMul/subsTime));
+    _spmvTime += eltSpmv;
+    _eMATime += eltMul;
+    // printf("Sub %d, counting val %e\n", subsId, subSum);
+    // std::fflush(stdout); 
+#endif
+
+// #ifdef VERBOSE
+//     printf("Sub %d, NonBottom raw count %e\n", subsId, countSum);
+//     std::fflush(stdout); 
+// #endif
+
+    return countSum;
+
+}/*}}}*/
+
+/**
+ * @brief the eMA of a combination over all of its splits
+ *
+ * @param subsId
+ * @param comb index of the combination in the count table
+ * @param auxSize
+ * @param bufLastSub the counts of root vertices for subsId 0
+ */
+void CountMat::multiplyComb(int subsId, int comb, int auxSize, double* bufLastSub)
+{/*{{{*/
+
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int subSize = _subtmp_array[subsId].get_vert_num();
+    int mainSize = indexer->getSubsSize()[idxMain];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
 
-           valType* xInput = _dTable.getAuxArray(colStart);
+    int* mainSplitLocal = (indexer->getSplitToCountTable())[0][subsId][comb]; 
+    int* auxSplitLocal = (indexer->getSplitToCountTable())[1][subsId][comb]; 
+    int combIdx = (indexer->getCombToCountTable())[subsId][comb];
 
-           // convert data structre from column-majored to row-majored
-#pragma omp parallel for num_threads(omp_get_max_threads())
-    for (int j = 0; j <_vert_num; ++j) 
-    {
-        for (int k = 0; k < batchSize; ++k) {
-            _bufMatX[j*batchSize+k] = xInput[k*_vert_num+j];
-        }
-    }
-           // clean yOuput
-#pragma omp parallel for num_threads(omp_get_max_threads())
-    for (int j = 0; j < _vert_num*batchSize; ++j) {
-        _bufMatY[j] = 0.0; 
-    }
-           
-#ifdef VERBOSE
-       spmvStart = utility::timer();
-#endif
-           // invoke the spmm kernel
-           _graphCSC->spmmSplit(_bufMatX, _bufMatY, batchSize, _thd_num);
+    float* objArray = nullptr;
+    if (subsId > 0)
+        objArray = _dTable->getCurTableArray(combIdx);
 
 #ifdef VERBOSE
-       _spmvElapsedTime += (utility::timer() - spmvStart);
+    double fmaStart = utility::timer();
 #endif
 
-           // convert data structure back to column-majored
-           valType* yOutput = (auxSize > 1) ? _dTable.getAuxArray(colStart) : _bufVecLeaf[colStart];
+    for (int j = 0; j < splitCombNum; ++j) {
 
-#pragma omp parallel for num_threads(omp_get_max_threads())
-    for (int j = 0; j < _vert_num; ++j) {
-        for (int k = 0; k < batchSize; ++k) {
-            yOutput[k*_vert_num+j] = _bufMatY[j*batchSize+k];
-        }
-    }
+        // already pre-computed by SpMV
+        float* auxArraySelect = nullptr;
+        if (auxSize > 1)
+            auxArraySelect = _dTable->getAuxArray(auxSplitLocal[j]);
+        else
+            auxArraySelect = _bufVecLeaf[auxSplitLocal[j]];
 
-           // increase colStart;
-           colStart += batchSize;
-       }
-   }
+        // element-wise mul 
+        float* mainArraySelect = _dTable->getMainArray(mainSplitLocal[j]);
 
-#ifdef VERBOSE
-   eltSpmv += (utility::timer() - startTimeComp); 
-#endif   
+        if (subsId > 0)
+        {
+            if (_isScaled == 0)
+                _dTable->arrayWiseFMAScale(objArray, auxArraySelect, mainArraySelect, 1.0e-12);
+            else
+                _dTable->arrayWiseFMAAVX(objArray, auxArraySelect, mainArraySelect);
+        }
+        else
+        {
+            // the last scale use 
+            _dTable->arrayWiseFMALast(bufLastSub, auxArraySelect, mainArraySelect);
+        }
+    }
 
 #ifdef VERBOSE
-   startTimeComp = utility::timer(); 
+    _fmaElapsedTime += (utility::timer() - fmaStart); 
 #endif
 
-// a second part only involves element-wise multiplication and updating
-    for(int i=0; i<countCombNum; i++)
-    {
-        int combIdx = combToCountLocal[i];
+}/*}}}*/
 
-// #ifdef VERBOSE
-//         printf("Sub: %d, comb: %d, combIdx: %d\n", subsId, i, combIdx);
-//         std::fflush(stdout);
-// #endif
+/**
+ * @brief group the combinations of subsId by the last SpMM batch 
+ * of aux columns they read, a combination is ready for eMA once 
+ * that batch is done
+ *
+ * @param subsId
+ * @param batchNum
+ * @param batchCombs
+ */
+void CountMat::getBatchCombs(int subsId, int batchNum, std::vector<std::vector<int> >& batchCombs)
+{/*{{{*/
 
-        if (subsId > 0)
-            objArray = _dTable.getCurTableArray(combIdx);
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int subSize = _subtmp_array[subsId].get_vert_num();
+    int mainSize = indexer->getSubsSize()[idxMain];
+    int countCombNum = indexer->getCombTable()[_color_num][subSize];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
+    int** auxSplitLocal = (indexer->getSplitToCountTable())[1][subsId]; 
 
+    batchCombs.assign(batchNum, std::vector<int>());
+    for (int i = 0; i < countCombNum; ++i)
+    {
+        int lastBatch = 0;
         for (int j = 0; j < splitCombNum; ++j) {
+            lastBatch = std::max(lastBatch, auxSplitLocal[i][j]/_bufMatCols);
+        }
 
-            int mainIdx = mainSplitLocal[i][j];
-            int auxIdx = auxSplitLocal[i][j];
+        batchCombs[lastBatch].push_back(i);
+    }
 
-// #ifdef VERBOSE
-//         printf("Sub: %d, mainIdx: %d, auxIdx: %d\n", subsId, mainIdx, auxIdx);
-//         std::fflush(stdout);
-// #endif
+}/*}}}*/
 
-            // already pre-computed by SpMV
-            float* auxArraySelect = nullptr;
-            if (auxSize > 1)
-                auxArraySelect = _dTable.getAuxArray(auxIdx);
-            else
-                auxArraySelect = _bufVecLeaf[auxIdx];
+/**
+ * @brief inverse index of the split table, the (comb, main) pairs 
+ * consuming each aux column of subsId
+ *
+ * @param subsId
+ * @param auxConsumers
+ */
+void CountMat::getAuxConsumers(int subsId, std::vector<std::vector<std::pair<int, int> > >& auxConsumers)
+{/*{{{*/
 
-            // element-wise mul 
-            float* mainArraySelect = _dTable.getMainArray(mainIdx);
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int idxAux = div_tp->get_aux_node_idx(subsId);
+    int subSize = _subtmp_array[subsId].get_vert_num();
+    int mainSize = indexer->getSubsSize()[idxMain];
+    int auxSize = indexer->getSubsSize()[idxAux];
+    int countCombNum = indexer->getCombTable()[_color_num][subSize];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
+    int auxTableLen = indexer->getCombTable()[_color_num][auxSize];
+    int** mainSplitLocal = (indexer->getSplitToCountTable())[0][subsId]; 
+    int** auxSplitLocal = (indexer->getSplitToCountTable())[1][subsId]; 
+
+    auxConsumers.assign(auxTableLen, std::vector<std::pair<int, int> >());
+    for (int i = 0; i < countCombNum; ++i) {
+        for (int j = 0; j < splitCombNum; ++j) {
+            auxConsumers[auxSplitLocal[i][j]].push_back(std::make_pair(i, mainSplitLocal[i][j]));
+        }
+    }
+
+}/*}}}*/
+
+/**
+ * @brief the eMA of all products reading a batch of SpMM outputs, 
+ * each aux column is re-used by its consumers while in cache
+ *
+ * @param subsId
+ * @param colStart first aux column of the batch
+ * @param batchSize
+ * @param colStride columns of the batch in _bufMatX
+ * @param auxConsumers
+ * @param bufLastSub
+ */
+void CountMat::multiplyAuxBatch(int subsId, int colStart, int batchSize, int colStride, 
+        std::vector<std::vector<std::pair<int, int> > >& auxConsumers, double* bufLastSub)
+{/*{{{*/
+
+    int* combToCountLocal = (indexer->getCombToCountTable())[subsId];
 
 #ifdef VERBOSE
-            fmaStart = utility::timer();
+    double fmaStart = utility::timer();
 #endif
 
+    for (int k = 0; k < batchSize; ++k) 
+    {
+        float* auxArraySelect = _bufMatX + (int64_t)k*colStride;
+        std::vector<std::pair<int, int> >& consumers = auxConsumers[colStart + k];
+
+        for (int c = 0; c < consumers.size(); ++c) 
+        {
+            float* mainArraySelect = _dTable->getMainArray(consumers[c].second);
+
             if (subsId > 0)
             {
+                float* objArray = _dTable->getCurTableArray(combToCountLocal[consumers[c].first]);
                 if (_isScaled == 0)
-                    _dTable.arrayWiseFMAScale(objArray, auxArraySelect, mainArraySelect, 1.0e-12);
+                    _dTable->arrayWiseFMAScale(objArray, auxArraySelect, mainArraySelect, 1.0e-12);
                 else
-                {
-                    _dTable.arrayWiseFMAAVX(objArray, auxArraySelect, mainArraySelect);
-                    // _dTable.arrayWiseFMA(objArray, auxArraySelect, mainArraySelect);
-
-                }
+                    _dTable->arrayWiseFMAAVX(objArray, auxArraySelect, mainArraySelect);
             }
             else
-            {
-                // the last scale use 
-                _dTable.arrayWiseFMALast(bufLastSub, auxArraySelect, mainArraySelect);
-            }
+                _dTable->arrayWiseFMALast(bufLastSub, auxArraySelect, mainArraySelect);
+        }
+    }
 
 #ifdef VERBOSE
-            _fmaElapsedTime += (utility::timer() - fmaStart); 
+    _fmaElapsedTime += (utility::timer() - fmaStart); 
 #endif
 
-        }
+}/*}}}*/
 
-        // if (subsId > 0)
-        //     subSum += sumVec(objArray, _vert_num);
+#ifdef DISTRI
+/**
+ * @brief SpMM by batches of _bufMatCols aux columns on the 1D partition,
+ * the halo rows of the next batch are exchanged while the current batch 
+ * is multiplied and the combinations completed by it run their eMA
+ *
+ * @param subsId
+ * @param auxSize
+ * @param auxTableLen
+ * @param bufLastSub
+ */
+void CountMat::spmmPipelined(int subsId, int auxSize, int auxTableLen, double* bufLastSub)
+{/*{{{*/
 
-    }
-#ifdef VERBOSE
-   eltMul += (utility::timer() - startTimeComp); 
-#endif
+    int batchNum = (auxTableLen + _bufMatCols - 1)/(_bufMatCols);
 
-    _isScaled = 1;
+    std::vector<std::vector<int> > batchCombs;
+    getBatchCombs(subsId, batchNum, batchCombs);
 
-    if (subsId == 0)
+    float* xCur = _bufMatX;
+    float* xNext = _bufMatXNext;
+
+    for (int i = 0; i < batchNum; ++i) 
     {
-        // sum the vals from bufLastSub  
-        for (int k = 0; k < _vert_num; ++k) {
-            countSum += bufLastSub[k];
+        int colStart = i*_bufMatCols;
+        int batchSize = (i < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
+
+        for (int b = ((i == 0) ? 0 : 1); b < 2 && i + b < batchNum; ++b)
+        {
+            // convert the batch from column-majored to row-majored and 
+            // start its exchange
+            int nextStart = colStart + b*_bufMatCols;
+            int nextSize = (i + b < batchNum -1) ? (_bufMatCols) : (auxTableLen - _bufMatCols*(batchNum-1));
+            valType* xInput = _dTable->getAuxArray(nextStart);
+            float* xBuf = (b == 0) ? xCur : xNext;
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+            for (int j = 0; j <_vert_num; ++j) 
+            {
+                for (int k = 0; k < nextSize; ++k) {
+                    xBuf[(int64_t)j*nextSize+k] = xInput[(int64_t)k*_vert_num+j];
+                }
+            }
+
+            // the first batch has nothing to overlap with
+            _graphDist->startHaloExchange(xBuf, nextSize);
+            if (b == 0)
+                _graphDist->waitHaloExchange();
         }
 
-        // to recover the scale down process
-        if (_isScaled == 1)
-            countSum *= 1.0e+12;
+#pragma omp parallel for num_threads(omp_get_max_threads())
+        for (int64_t j = 0; j < (int64_t)_vert_num*batchSize; ++j) {
+            _bufMatY[j] = 0.0; 
+        }
 
-#ifdef __INTEL_COMPILER
-        _mm_free(bufLastSub);
-#else
-        free(bufLastSub);
+#ifdef VERBOSE
+        double spmvStart = utility::timer();
 #endif
-    }
-
+        _graphDist->spmmLocal(xCur, _bufMatY, batchSize, _thd_num);
 #ifdef VERBOSE
-    double subsTime = (utility::timer() - startTime);
-    printf("Sub %d, counting time %f, Spmv time %f: ratio: %f\%,  Mul time %f: ratio: %f\% \n", subsId, subsTime, eltSpmv, 100*(eltSpmv/subsTime), eltMul, 100*(eltMul/subsTime));
-    _spmvTime += eltSpmv;
-    _eMATime += eltMul;
-    // printf("Sub %d, counting val %e\n", subsId, subSum);
-    // std::fflush(stdout); 
+        _spmvElapsedTime += (utility::timer() - spmvStart);
 #endif
 
-// #ifdef VERBOSE
-//     printf("Sub %d, NonBottom raw count %e\n", subsId, countSum);
-//     std::fflush(stdout); 
-// #endif
+        valType* yOutput = (auxSize > 1) ? _dTable->getAuxArray(colStart) : _bufVecLeaf[colStart];
 
-    return countSum;
+#pragma omp parallel for num_threads(omp_get_max_threads())
+        for (int j = 0; j < _vert_num; ++j) {
+            for (int k = 0; k < batchSize; ++k) {
+                yOutput[(int64_t)k*_vert_num+j] = _bufMatY[(int64_t)j*batchSize+k];
+            }
+        }
+
+        for (int c = 0; c < batchCombs[i].size(); ++c) {
+            multiplyComb(subsId, batchCombs[i][c], auxSize, bufLastSub);
+        }
+
+        if (i + 1 < batchNum)
+        {
+            _graphDist->waitHaloExchange();
+            std::swap(xCur, xNext);
+        }
+    }
 
 }/*}}}*/
+#endif
 
 double CountMat::countNonBottomeOriginal(int subsId)
 {/*{{{*/
@@ -864,11 +1806,11 @@ double CountMat::countNonBottomeOriginal(int subsId)
 
     int subSize = _subtmp_array[subsId].get_vert_num();
 
-    int idxMain = div_tp.get_main_node_idx(subsId);
-    int mainSize = indexer.getSubsSize()[idxMain];
+    int idxMain = div_tp->get_main_node_idx(subsId);
+    int mainSize = indexer->getSubsSize()[idxMain];
 
-    int countCombNum = indexer.getCombTable()[_color_num][subSize];
-    int splitCombNum = indexer.getCombTable()[subSize][mainSize];
+    int countCombNum = indexer->getCombTable()[_color_num][subSize];
+    int splitCombNum = indexer->getCombTable()[subSize][mainSize];
 
 #ifdef VERBOSE
     printf("Finish init sub templte %d, vert: %d, comb: %d, splitNum: %d\n", subsId, subSize, 
@@ -877,9 +1819,9 @@ double CountMat::countNonBottomeOriginal(int subsId)
 #endif
 
     double countSum = 0.0;
-    int** mainSplitLocal = (indexer.getSplitToCountTable())[0][subsId]; 
-    int** auxSplitLocal = (indexer.getSplitToCountTable())[1][subsId]; 
-    int* combToCountLocal = (indexer.getCombToCountTable())[subsId];
+    int** mainSplitLocal = (indexer->getSplitToCountTable())[0][subsId]; 
+    int** auxSplitLocal = (indexer->getSplitToCountTable())[1][subsId]; 
+    int* combToCountLocal = (indexer->getCombToCountTable())[subsId];
 
     float* bufLastSub = nullptr;
     float* objArray = nullptr;
@@ -913,34 +1855,34 @@ double CountMat::countNonBottomeOriginal(int subsId)
         if (subsId == 0)
             objArray = bufLastSub;
         else
-            objArray = _dTable.getCurTableArray(combIdx);
+            objArray = _dTable->getCurTableArray(combIdx);
 
         for (int j = 0; j < splitCombNum; ++j) {
 
             int mainIdx = mainSplitLocal[i][j];
             int auxIdx = auxSplitLocal[i][j];
 
-            float* auxArraySelect = _dTable.getAuxArray(auxIdx);
+            float* auxArraySelect = _dTable->getAuxArray(auxIdx);
             // spmv
 #ifdef VERBOSE
             startTimeComp = utility::timer();
 #endif
             if (_graph != nullptr)
-                _graph->SpMVNaiveFull(auxArraySelect, _bufVec, _thd_num);
+                _graph->SpMVMergePath(auxArraySelect, _bufVec, _thd_num);
             else
-                _graphCSC->spmvNaiveSplit(auxArraySelect, _bufVec, _thd_num);
+                multiplyCSC(auxArraySelect, _bufVec, 0);
 
 #ifdef VERBOSE
             eltSpmv += (utility::timer() - startTimeComp);
 #endif
 
             // element-wise mul 
-            float* mainArraySelect = _dTable.getMainArray(mainIdx);
+            float* mainArraySelect = _dTable->getMainArray(mainIdx);
 #ifdef VERBOSE
             startTimeComp = utility::timer();
 #endif
 
-            _dTable.arrayWiseFMANaive(objArray, _bufVec, mainArraySelect);
+            _dTable->arrayWiseFMANaive(objArray, _bufVec, mainArraySelect);
 #ifdef VERBOSE
             eltMul += (utility::timer() - startTimeComp);
 #endif
@@ -980,14 +1922,17 @@ void CountMat::colorInit()
 {
 #pragma omp parallel
     {
-        // each thread has a seed for ranodm number generation
-        srand(time(0)+ omp_get_thread_num());
+        // each thread has a seed for ranodm number generation, 
+        // advanced at each coloring so that iterations are independent
+        unsigned int seed = _colorSeed ^ (2654435761u*(_colorItr*omp_get_num_threads() + omp_get_thread_num() + 1));
 
 #pragma omp for
         for (int i = 0; i < _vert_num; ++i) {
-            _colors_local[i] = (rand()%_color_num);
+            _colors_local[i] = (rand_r(&seed)%_color_num);
         }
     }
+
+    _colorItr++;
 }
 
 int CountMat::factorial(int n)
@@ -1055,8 +2000,8 @@ void CountMat::printSubTemps()
         int vert_self = _subtmp_array[s].get_vert_num();
         if (vert_self > 1)
         {
-            int main_leaf = div_tp.get_main_node_vert_num(s);
-            int aux_leaf = div_tp.get_aux_node_vert_num(s);
+            int main_leaf = div_tp->get_main_node_vert_num(s);
+            int aux_leaf = div_tp->get_aux_node_vert_num(s);
             printf("Temp Sizes: Self %d, main: %d, aux: %d\n", vert_self, main_leaf, aux_leaf);
             std::fflush(stdout);
             assert((main_leaf + aux_leaf == vert_self));
@@ -1068,18 +2013,9 @@ void CountMat::estimatePeakMemUsage()
 {
 
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
     double peakMem = 0.0;
     double memSub = 0.0;
@@ -1094,16 +2030,16 @@ void CountMat::estimatePeakMemUsage()
         int vert_self = _subtmp_array[s].get_vert_num();
         if (vert_self > 1)
         {
-            memSub += (_dTable.getTableLen(s)*memPerIndx);
+            memSub += (_dTable->getTableLen(s)*memPerIndx);
             peakMem = (memSub > peakMem) ? memSub : peakMem;
 
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);
             if (_subtmp_array[idxMain].get_vert_num() > 1)
-                memSub -= (_dTable.getTableLen(idxMain)*memPerIndx);
+                memSub -= (_dTable->getTableLen(idxMain)*memPerIndx);
 
             if (_subtmp_array[idxAux].get_vert_num() > 1)
-                memSub -= (_dTable.getTableLen(idxAux)*memPerIndx);
+                memSub -= (_dTable->getTableLen(idxAux)*memPerIndx);
         }
     }
 
@@ -1114,30 +2050,35 @@ void CountMat::estimatePeakMemUsage()
     std::fflush(stdout);
 }
 
-double CountMat::estimateMemCommPGBSC()
+/**
+ * @brief bytes of SpMM per column of an aux table, and 
+ * bytes of eMA per column of a sub-template table
+ *
+ * @param bytesSpmvPer
+ * @param bytesFMAPer
+ */
+void CountMat::getCommBytesPGBSC(double& bytesSpmvPer, double& bytesFMAPer)
 {
-
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
-    double commBytesTotal = 0.0;
     // AB = C
     // nnz row id, nnz col id, batch of 16 (nnz 16 + nnz 16 write)
-    double bytesSpmvPer = sizeof(float)*(2*(double)nnz) + sizeof(int)*((double)2*nnz/16);
+    bytesSpmvPer = sizeof(float)*(2*(double)nnz) + sizeof(int)*((double)2*nnz/16);
     // z += x*y
     // read x, y, z 
-    double bytesFMAPer = sizeof(float)*(n*3);
+    bytesFMAPer = sizeof(float)*((double)n*3);
+}
+
+double CountMat::estimateMemCommPGBSC()
+{
+
+    double commBytesTotal = 0.0;
+    double bytesSpmvPer = 0.0;
+    double bytesFMAPer = 0.0;
+    getCommBytesPGBSC(bytesSpmvPer, bytesFMAPer);
 
     for(int s=_total_sub_num-1;s>=0;s--)
     {
@@ -1145,15 +2086,15 @@ double CountMat::estimateMemCommPGBSC()
         if (vert_self > 1) {
             
             // spmv part
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             if (_subtmp_array[idxAux].get_vert_num() > 1)
             {
-                _spmvMemBytes += (bytesSpmvPer*_dTable.getTableLen(idxAux));
+                _spmvMemBytes += (bytesSpmvPer*_dTable->getTableLen(idxAux));
             }
 
             // FMA part
-            _fmaMemBytes += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
+            _fmaMemBytes += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
                     bytesFMAPer);
         }
     }
@@ -1173,18 +2114,9 @@ double CountMat::estimateMemCommFascia()
 {
 
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
     double commBytesTotal = 0.0;
     double commBytesComb = sizeof(float)*(double)n + sizeof(int)*n;
@@ -1199,11 +2131,11 @@ double CountMat::estimateMemCommFascia()
         int vert_self = _subtmp_array[s].get_vert_num();
         if (vert_self > 1) {
             
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             
-            commBytesTotal += (_dTable.getTableLen(s)*(commBytesComb));
-            commBytesTotal += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*(commBytesSplit));
+            commBytesTotal += (_dTable->getTableLen(s)*(commBytesComb));
+            commBytesTotal += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*(commBytesSplit));
         }
     }
 
@@ -1218,18 +2150,9 @@ double CountMat::estimateMemCommPrunedFascia()
 {
 
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
     double commBytesTotal = 0.0;
     double commBytesPrune = sizeof(float)*(double)nnz;
@@ -1241,16 +2164,16 @@ double CountMat::estimateMemCommPrunedFascia()
         int vert_self = _subtmp_array[s].get_vert_num();
         if (vert_self > 1) {
             
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
      
             if (_subtmp_array[idxAux].get_vert_num() > 1)
             {
-                commBytesTotal += (commBytesPrune*_dTable.getTableLen(idxAux));
+                commBytesTotal += (commBytesPrune*_dTable->getTableLen(idxAux));
             }       
 
-            commBytesTotal += (_dTable.getTableLen(s)*(commBytesComb));
-            commBytesTotal += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*(commBytesSplit));
+            commBytesTotal += (_dTable->getTableLen(s)*(commBytesComb));
+            commBytesTotal += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*(commBytesSplit));
         }
     }
 
@@ -1266,21 +2189,12 @@ double CountMat::estimateMemCommPrunedFascia()
 double CountMat::estimateFlopsPGBSC()
 {
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
 
-    printf("|V| is: %d, |E| nnz is: %d \n", n , nnz );
+    printf("|V| is: %d, |E| nnz is: %ld \n", n , (long)nnz );
     std::fflush(stdout);
 
     double flopsTotal = 0.0;
@@ -1294,15 +2208,15 @@ double CountMat::estimateFlopsPGBSC()
         if (vert_self > 1) {
             
             // spmv part
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             if (_subtmp_array[idxAux].get_vert_num() > 1)
             {
-                _spmvFlops += (flopsSpmvPer*_dTable.getTableLen(idxAux));
+                _spmvFlops += (flopsSpmvPer*_dTable->getTableLen(idxAux));
             }
 
             // FMA part
-            _fmaFlops += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
+            _fmaFlops += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
                     flopsFMAPer);
         }
     }
@@ -1322,21 +2236,12 @@ double CountMat::estimateFlopsPGBSC()
 double CountMat::estimateFlopsPrunedFascia()
 {
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
 
-    printf("|V| is: %d, |E| nnz is: %d \n", n , nnz );
+    printf("|V| is: %d, |E| nnz is: %ld \n", n , (long)nnz );
     std::fflush(stdout);
 
     double flopsTotal = 0.0;
@@ -1350,14 +2255,14 @@ double CountMat::estimateFlopsPrunedFascia()
         if (vert_self > 1) {
             
             // spmv part
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             if (_subtmp_array[idxAux].get_vert_num() > 1)
             {
-                flopsTotal += (flopsPrunedPer*_dTable.getTableLen(idxAux));
+                flopsTotal += (flopsPrunedPer*_dTable->getTableLen(idxAux));
             }           
 
-            flopsTotal += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
+            flopsTotal += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
                     flopsPer);
         }
     }
@@ -1373,6 +2278,10 @@ double CountMat::estimateFlopsPrunedFascia()
 
 void CountMat::degreeDistribution()
 {
+    // the degree list is not kept by the distributed graph
+    if (_graph == nullptr && _graphCSC == nullptr)
+        return;
+
     // output the distribution of input graph vertices
     idxType* degList = (_graph != nullptr) ? _graph->getDegList() : _graphCSC->getDegList();
     // find the max degree
@@ -1403,20 +2312,11 @@ double CountMat::estimateFlopsFascia()
 {
 
     idxType n = 0; 
-    idxType nnz = 0; 
+    offType nnz = 0; 
 
-    if (_graph != nullptr)
-    {
-        n = _graph->getNumVertices();
-        nnz = _graph->getNNZ();
-    }
-    else
-    {
-        n = _graphCSC->getNumVertices();
-        nnz = _graphCSC->getNNZ();
-    }
+    getGraphSize(n, nnz);
 
-    printf("|V| is: %d, |E| nnz is: %d \n", n, nnz);
+    printf("|V| is: %d, |E| nnz is: %ld \n", n, (long)nnz);
     std::fflush(stdout);
 
     double flopsTotal = 0.0;
@@ -1429,10 +2329,10 @@ double CountMat::estimateFlopsFascia()
         if (vert_self > 1) {
             
             // spmv part
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             
-            flopsTotal += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
+            flopsTotal += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
                     flopsPer);
         }
     }
@@ -1471,20 +2371,20 @@ double CountMat::estimateTemplate()
         if (vert_self > 1) {
             
             // spmv part
-            int idxMain = div_tp.get_main_node_idx(s);
-            int idxAux = div_tp.get_aux_node_idx(s);       
+            int idxMain = div_tp->get_main_node_idx(s);
+            int idxAux = div_tp->get_aux_node_idx(s);       
             if (_subtmp_array[idxAux].get_vert_num() > 1)
             {
-                 workloadNNZ += (perSpMV*_dTable.getTableLen(idxAux));
-                 memloadNNZ += (12*_dTable.getTableLen(idxAux)); 
-                 memloadN += (8*_dTable.getTableLen(idxAux)); 
+                 workloadNNZ += (perSpMV*_dTable->getTableLen(idxAux));
+                 memloadNNZ += (12*_dTable->getTableLen(idxAux)); 
+                 memloadN += (8*_dTable->getTableLen(idxAux)); 
             }
 
             // FMA part
-            workloadN += (_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
+            workloadN += (_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())*
                     pereMA);
 
-            memloadN += (16*_dTable.getTableLen(s)*indexer.comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())); 
+            memloadN += (16*_dTable->getTableLen(s)*indexer->comb_calc(vert_self, _subtmp_array[idxAux].get_vert_num())); 
 
         }
     }
@@ -1495,80 +2395,9 @@ double CountMat::estimateTemplate()
 
 }
 
-int CountMat::automorphismNum()
-{
-    std::vector<int> mappingID;
-    std::vector<int> restID;
-
-    for (int i = 0; i < _templates->get_vert_num(); ++i) {
-        restID.push_back(i);
-    }
-
-    return calcAutomorphismRecursive((*_templates), mappingID, restID);
-}
-
-int CountMat::calcAutomorphismZero(Graph& t, std::vector<int>& mappingID)
-{
-    for (int i = 0; i < mappingID.size(); ++i) {
-       if (t.get_out_deg(i) != t.get_out_deg(mappingID[i])) 
-           return 0;
-       else
-       {
-           int* adjList = t.get_adj_list(i);
-           int* adjListMap = t.get_adj_list(mappingID[i]);
-           int end = t.get_out_deg(i);
-
-           bool* isMatch = new bool[end];
-           for (int j = 0; j < end; ++j) {
-               isMatch[j] = false;
-               int u = adjList[j];
-               for (int k = 0; k < end; ++k) {
-                   int u_map = adjListMap[k];
-                   if (u == mappingID[u_map])
-                       isMatch[j] = true;
-               }
-               
-           }
-
-           for (int k = 0; k < end; ++k) {
-              
-               if (!isMatch[k])
-                   return 0;
-           }
-
-       }
-        
-    }
-    return 1;
-}
-
-int CountMat::calcAutomorphismRecursive(Graph& t, std::vector<int>& mappingID, std::vector<int>& restID)
+double CountMat::automorphismNum()
 {
-    int count = 0;
-    if (!restID.size())
-    {
-        return calcAutomorphismZero(t, mappingID); 
-    }
-    else
-    {
-        for (int i = 0; i < restID.size(); ++i) {
-            mappingID.push_back(restID[i]);
-            std::vector<int> newRestID;
-            for (int j = 0; j < restID.size(); ++j) {
-                if (i!=j)
-                    newRestID.push_back(restID[j]);
-                
-            }
-
-            count += calcAutomorphismRecursive(t, mappingID, newRestID);
-            newRestID.clear();
-            mappingID.pop_back();
-        }
-
-    }
-
-    return count;
-
+    return _templates->get_automorphism_num();
 }
 
 
@@ -5,34 +5,73 @@
 #include <stdio.h>
 #include <cstring>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <string>
 // #include <string.h>
 
 #include "Graph.hpp"
 #include "CSRGraph.hpp"
 #include "CSCGraph.hpp"
+#include "DistCSCGraph.hpp"
 #include "DivideTemplates.hpp"
 #include "IndexSys.hpp"
 #include "DataTableColMajor.hpp"
 
 using namespace std;
 
+// how a sub-template gets its table when isomorphic sub-templates
+// are counted on the same coloring
+#define SHARE_COMPUTE 0
+#define SHARE_SKIP 1
+#define SHARE_LINK 2
+#define SHARE_COPY 3
+#define SHARE_LINK_SPMV 4
+
+// flags of sub-templates whose tables are re-used by later sub-templates
+#define SHARE_KEEP_RAW 1
+#define SHARE_KEEP_SPMV 2
+#define SHARE_AUX 4
+
 class CountMat {
 
     public:
 
         typedef int32_t idxType;
+        // edge and nnz counts
+        typedef int64_t offType;
         typedef float valType;
 
-        CountMat(): _graph(nullptr), _graphCSC(nullptr), _templates(nullptr), _subtmp_array(nullptr), _colors_local(nullptr), 
-        _bufVec(nullptr), _bufMatY(nullptr), _bufMatX(nullptr), _bufMatCols(-1), _bufVecLeaf(nullptr), _spmvTime(0), _eMATime(0), 
-        _isPruned(1), _isScaled(0), _useSPMM(0), _peakMemUsage(0), _spmvElapsedTime(0), _fmaElapsedTime(0), _spmvFlops(0),
-        _spmvMemBytes(0), _fmaFlops(0), _fmaMemBytes(0), _vtuneStart(-1), _calculate_automorphisms(false), 
+        CountMat(): _graph(nullptr), _graphCSC(nullptr), _graphDist(nullptr), _templates(nullptr), _subtmp_array(nullptr), _templateList(nullptr), 
+        _subtmpList(nullptr), _templateNum(0), _curTemplate(0), _colors_local(nullptr), _colorSeed(0), _colorItr(0), _itrRank(0), _itrProcNum(1), div_tp(nullptr), _dTable(nullptr), 
+        indexer(nullptr), _divList(nullptr), _indexerList(nullptr), _dTableList(nullptr), _shareAction(nullptr), 
+        _shareFlags(nullptr), _subCanon(nullptr), 
+        _bufVec(nullptr), _bufMatY(nullptr), _bufMatX(nullptr), _bufMatXNext(nullptr), _bufMatCols(-1), _bufVecLeaf(nullptr), _spmvTime(0), _eMATime(0), 
+        _isPruned(1), _isScaled(0), _useSPMM(0), _useStream(0), _spmmBackend(SPMM_SPLIT), _peakMemUsage(0), _spmvElapsedTime(0), _fmaElapsedTime(0), _spmvFlops(0),
+        _spmvMemBytes(0), _fmaFlops(0), _fmaMemBytes(0), _vtuneStart(-1), _calculate_automorphisms(true), 
         _useCSC(1) {} 
 
         void initialization(CSRGraph* graph, CSCGraph<int32_t, float>* graphCSC, int thd_num, int itr_num, int isPruned, int useSPMM, int vtuneStart=-1,
-                bool calculate_automorphisms = false);
+                bool calculate_automorphisms = true);
+#ifdef DISTRI
+        // the graph is vertex partitioned across the ranks, 
+        // counted by the pruned SpMM algorithm
+        void initialization(DistCSCGraph* graph, int thd_num, int itr_num, int vtuneStart=-1,
+                bool calculate_automorphisms = true);
+        // each process of comm holds the whole graph and runs 
+        // the iterations i with i % size == rank
+        void setIterationComm(MPI_Comm comm);
+#endif
+
+        // SpMM outputs consumed by batches in the pruned SpMM algorithm
+        void setStreaming(int useStream) {_useStream = useStream;}
+        // SpMM kernel of the CSC graph, SPMM_SPLIT, SPMM_PB, SPMM_TILED, SPMM_COMPRESSED, 
+        // SPMM_PULL, or SPMM_AUTO to pick push or pull by timing the first batches
+        void setSpMMBackend(int backend) {_spmmBackend = backend;}
 
         double compute(Graph& templates, bool isEstimate = false);
+        // count several templates of the same size on shared colorings
+        void compute(Graph* templates, int templateNum, double* finalCounts, bool isEstimate = false);
 
         ~CountMat() 
         {
@@ -66,6 +105,15 @@ class CountMat {
 #endif
             }
 
+            if (_bufMatXNext != nullptr)
+            {
+#ifdef __INTEL_COMPILER
+                _mm_free(_bufMatXNext); 
+#else
+                free(_bufMatXNext); 
+#endif
+            }
+
             if (_bufVecLeaf != nullptr) 
             {
                 if (_useSPMM == 0)
@@ -93,13 +141,38 @@ class CountMat {
                 free(_bufVecLeaf);
             }
 
-            
+            releaseSharedSubTemps();
 
+            // tables are released before the index systems 
+            if (_dTableList != nullptr)
+                delete[] _dTableList;
+
+            if (_indexerList != nullptr)
+                delete[] _indexerList;
+
+            if (_divList != nullptr)
+                delete[] _divList;
+
+            if (_subtmpList != nullptr)
+                delete[] _subtmpList;
+
+            if (_shareAction != nullptr)
+                delete[] _shareAction;
+
+            if (_shareFlags != nullptr)
+                delete[] _shareFlags;
+
+            if (_subCanon != nullptr)
+                delete[] _subCanon;
         }
 
 
         double estimateFlopsPGBSC();
         double estimateMemCommPGBSC();
+        void getCommBytesPGBSC(double& bytesSpmvPer, double& bytesFMAPer);
+#ifdef DISTRI
+        bool checkDivisionAcrossRanks(int t);
+#endif
 
         double estimateFlopsFascia();
         double estimateMemCommFascia();
@@ -111,18 +184,45 @@ class CountMat {
         void degreeDistribution();
         double estimateTemplate();
 
-        int automorphismNum();
+        double automorphismNum();
 
     private:
 
-        int calcAutomorphismRecursive(Graph& t, std::vector<int>& mappingID, std::vector<int>& restID);
-        int calcAutomorphismZero(Graph& t, std::vector<int>& mappingID);
+        void initBuffers(int thd_num, int itr_num, int isPruned, int useSPMM, int vtuneStart, 
+                bool calculate_automorphisms, idxType haloNum);
+        // vertices and nnz processed by this process
+        void getGraphSize(idxType& n, offType& nnz);
+        void multiplyCSC(valType* x, valType* y, int width);
+
+        void prepareTemplate(int t);
+        void selectTemplate(int t);
+
+        // re-use the tables of isomorphic sub-templates across templates
+        void planSharedSubTemps();
+        // and across isomorphic sub-templates within one template
+        void planLocalSubTemps(int t);
+        bool isLocalPlanValid(int t, std::vector<int>& parents, std::vector<bool>& isLocal);
+        void markReachedSubTemps(int t, std::vector<bool>& isReached);
+        void getSubParents(int t, std::vector<int>& parents);
+        int findRawProducer(int t, string& key, std::vector<bool>& isReached);
+        int findSpmvProducer(int t, string& key, std::vector<int>& parents, std::vector<bool>& isReached);
+        void linkSharedSubTemp(int subsId);
+        void keepSharedSubTemp(int subsId, bool isSpmv);
+        void releaseSharedSubTemps();
 
         double colorCounting();
         double sumVec(valType* input, idxType len);
         void scaleVec(valType* input, idxType len, double scale);
         double countNonBottomePruned(int subsId);
         double countNonBottomePrunedSPMM(int subsId);
+        void multiplyComb(int subsId, int comb, int auxSize, double* bufLastSub);
+        void getBatchCombs(int subsId, int batchNum, std::vector<std::vector<int> >& batchCombs);
+        void getAuxConsumers(int subsId, std::vector<std::vector<std::pair<int, int> > >& auxConsumers);
+        void multiplyAuxBatch(int subsId, int colStart, int batchSize, int colStride, 
+                std::vector<std::vector<std::pair<int, int> > >& auxConsumers, double* bufLastSub);
+#ifdef DISTRI
+        void spmmPipelined(int subsId, int auxSize, int auxTableLen, double* bufLastSub);
+#endif
         double countNonBottomeOriginal(int subsId);
         void colorInit();
         // trace the process mem usage
@@ -136,6 +236,7 @@ class CountMat {
         // local graph data
         CSRGraph* _graph;
         CSCGraph<int32_t, float>* _graphCSC;
+        DistCSCGraph* _graphDist;
 
         idxType _vert_num;
 
@@ -143,11 +244,26 @@ class CountMat {
         Graph* _templates; 
         Graph* _subtmp_array;
         int _total_sub_num;
+
+        // all of the templates counted on the same colorings
+        Graph* _templateList;
+        Graph** _subtmpList;
+        int _templateNum;
+        int _curTemplate;
         // total color num equals to the size of template
         int _color_num;
 
         // local coloring for each verts
         int* _colors_local;
+        unsigned int _colorSeed;
+        unsigned int _colorItr;
+
+        // iterations split over processes
+        int _itrRank;
+        int _itrProcNum;
+#ifdef DISTRI
+        MPI_Comm _itrComm;
+#endif
 
         // iterations
         int _itr_num;
@@ -157,17 +273,41 @@ class CountMat {
         int _thd_num;
 
         // divide the templates into sub-templates
-        DivideTemplates div_tp;
+        DivideTemplates* div_tp;
 
         // counts table
-        DataTableColMajor _dTable;
+        DataTableColMajor* _dTable;
 
         // index system
-        IndexSys indexer;
+        IndexSys* indexer;
+
+        // per template of _templateList, 
+        // div_tp, _dTable and indexer point to the selected one
+        DivideTemplates* _divList;
+        IndexSys* _indexerList;
+        DataTableColMajor* _dTableList;
+
+        // scale applied to the table of each sub-template
+        std::vector<double> _subScale;
+
+        // a sub-template table kept for the later templates of a coloring
+        struct SharedTable {
+            float** table;
+            int len;
+            double scale;
+        };
+
+        // per template and sub-template: SHARE_* action, flags and canonical form
+        std::vector<int>* _shareAction;
+        std::vector<int>* _shareFlags;
+        std::vector<string>* _subCanon;
+        std::map<string, SharedTable> _sharedTables;
         
         float* _bufVec;
         float* _bufMatY;
         float* _bufMatX;
+        // the batch in exchange while _bufMatX is multiplied
+        float* _bufMatXNext;
         int _bufMatCols;
 
         float** _bufVecLeaf;
@@ -176,6 +316,11 @@ class CountMat {
         int _isPruned;
         int _isScaled;
         int _useSPMM;
+        int _useStream;
+        int _spmmBackend;
+        // first push and pull kernel times of each SpMM width, -1 if not run
+        std::vector<double> _pushTimes;
+        std::vector<double> _pullTimes;
         double _peakMemUsage;
         bool _calculate_automorphisms;
 
@@ -7,10 +7,183 @@
 // use avx intrinsics
 #include "immintrin.h"
 #include "zmmintrin.h"
+#elif defined(ISA_HAS_AVX2) || defined(ISA_HAS_AVX512)
+#include <immintrin.h>
 #endif
 
 using namespace std;
 
+// kernels of a block of the FMA arrays for each ISA, the blocks of the 
+// threads start at any float, so the vector loads are unaligned
+
+// dst += a*b 
+static void fmaBlockScalar(float* dst, float* a, float* b, int len)
+{
+    for(int j=0; j<len;j++)
+        dst[j] = dst[j] + a[j]*b[j];
+}
+
+// dst += (a*b)*scale, computed in double
+static void fmaScaleBlockScalar(float* dst, float* a, float* b, float scale, int len)
+{
+    for(int j=0; j<len;j++)
+        dst[j] = dst[j] + (a[j]*(double)b[j])*scale;
+}
+
+// dst += a*b, the float products added to a double dst
+static void fmaLastBlockScalar(double* dst, float* a, float* b, int len)
+{
+    for(int j=0; j<len;j++)
+        dst[j] = dst[j] + a[j]*b[j];
+}
+
+#ifdef ISA_HAS_AVX2
+ISA_TARGET_AVX2 static void fmaBlockAVX2(float* dst, float* a, float* b, int len)
+{/*{{{*/
+    // unrolled by 8 float
+    int n8 = len & ~(8-1); 
+
+    for (int j = 0; j < n8; j+=8)
+    {
+        __m256 vecA = _mm256_loadu_ps (&(a[j]));
+        __m256 vecB = _mm256_loadu_ps (&(b[j]));
+        __m256 vecC = _mm256_loadu_ps (&(dst[j]));
+        _mm256_storeu_ps(&(dst[j]), _mm256_fmadd_ps(vecA, vecB, vecC));
+    }
+
+    fmaBlockScalar(dst + n8, a + n8, b + n8, len - n8);
+}/*}}}*/
+
+ISA_TARGET_AVX2 static void fmaScaleBlockAVX2(float* dst, float* a, float* b, float scale, int len)
+{/*{{{*/
+    int n4 = len & ~(4-1); 
+    __m256d vecScale = _mm256_set1_pd((double)scale);
+
+    for (int j = 0; j < n4; j+=4)
+    {
+        __m256d vecA = _mm256_cvtps_pd(_mm_loadu_ps (&(a[j])));
+        __m256d vecB = _mm256_cvtps_pd(_mm_loadu_ps (&(b[j])));
+        __m256d vecC = _mm256_cvtps_pd(_mm_loadu_ps (&(dst[j])));
+        __m256d vecBuf = _mm256_add_pd(vecC, _mm256_mul_pd(_mm256_mul_pd(vecA, vecB), vecScale));
+        _mm_storeu_ps(&(dst[j]), _mm256_cvtpd_ps(vecBuf));
+    }
+
+    fmaScaleBlockScalar(dst + n4, a + n4, b + n4, scale, len - n4);
+}/*}}}*/
+
+ISA_TARGET_AVX2 static void fmaLastBlockAVX2(double* dst, float* a, float* b, int len)
+{/*{{{*/
+    int n4 = len & ~(4-1); 
+
+    for (int j = 0; j < n4; j+=4)
+    {
+        __m128 vecAB = _mm_mul_ps(_mm_loadu_ps (&(a[j])), _mm_loadu_ps (&(b[j])));
+        __m256d vecC = _mm256_loadu_pd (&(dst[j]));
+        _mm256_storeu_pd(&(dst[j]), _mm256_add_pd(vecC, _mm256_cvtps_pd(vecAB)));
+    }
+
+    fmaLastBlockScalar(dst + n4, a + n4, b + n4, len - n4);
+}/*}}}*/
+#endif
+
+#ifdef ISA_HAS_AVX512
+ISA_TARGET_AVX512 static void fmaBlockAVX512(float* dst, float* a, float* b, int len)
+{/*{{{*/
+    // unrolled by 16 float
+    int n16 = len & ~(16-1); 
+    __m512 tmpzero = _mm512_set1_ps (0);
+    __mmask16 mask = (1 << (len - n16)) - 1;
+
+    for (int j = 0; j < n16; j+=16)
+    {
+        __m512 vecA = _mm512_loadu_ps (&(a[j]));
+        __m512 vecB = _mm512_loadu_ps (&(b[j]));
+        __m512 vecC = _mm512_loadu_ps (&(dst[j]));
+        _mm512_storeu_ps(&(dst[j]), _mm512_fmadd_ps(vecA, vecB, vecC));
+    }
+
+    if (n16 < len)
+    {
+        __m512 vecA = _mm512_mask_loadu_ps(tmpzero, mask, &(a[n16]));
+        __m512 vecB = _mm512_mask_loadu_ps(tmpzero, mask, &(b[n16]));
+        __m512 vecC = _mm512_mask_loadu_ps(tmpzero, mask, &(dst[n16]));
+        _mm512_mask_storeu_ps(&(dst[n16]), mask, _mm512_fmadd_ps(vecA, vecB, vecC));
+    }
+}/*}}}*/
+
+// the zero-masked conversions, gcc warns on the undefined 
+// source register of the unmasked ones
+ISA_TARGET_AVX512 static void fmaScaleBlockAVX512(float* dst, float* a, float* b, float scale, int len)
+{/*{{{*/
+    int n8 = len & ~(8-1); 
+    __m512d vecScale = _mm512_set1_pd((double)scale);
+
+    for (int j = 0; j < n8; j+=8)
+    {
+        __m512d vecA = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps (&(a[j])));
+        __m512d vecB = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps (&(b[j])));
+        __m512d vecC = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps (&(dst[j])));
+        __m512d vecBuf = _mm512_add_pd(vecC, _mm512_mul_pd(_mm512_mul_pd(vecA, vecB), vecScale));
+        _mm256_storeu_ps(&(dst[j]), _mm512_maskz_cvtpd_ps(0xFF, vecBuf));
+    }
+
+    fmaScaleBlockScalar(dst + n8, a + n8, b + n8, scale, len - n8);
+}/*}}}*/
+
+ISA_TARGET_AVX512 static void fmaLastBlockAVX512(double* dst, float* a, float* b, int len)
+{/*{{{*/
+    int n8 = len & ~(8-1); 
+
+    for (int j = 0; j < n8; j+=8)
+    {
+        __m256 vecAB = _mm256_mul_ps(_mm256_loadu_ps (&(a[j])), _mm256_loadu_ps (&(b[j])));
+        __m512d vecC = _mm512_loadu_pd (&(dst[j]));
+        _mm512_storeu_pd(&(dst[j]), _mm512_add_pd(vecC, _mm512_maskz_cvtps_pd(0xFF, vecAB)));
+    }
+
+    fmaLastBlockScalar(dst + n8, a + n8, b + n8, len - n8);
+}/*}}}*/
+#endif
+
+static void fmaBlock(float* dst, float* a, float* b, int len, int isa)
+{
+#ifdef ISA_HAS_AVX512
+    if (isa == ISA_AVX512)
+        return fmaBlockAVX512(dst, a, b, len);
+#endif
+#ifdef ISA_HAS_AVX2
+    if (isa == ISA_AVX2)
+        return fmaBlockAVX2(dst, a, b, len);
+#endif
+    fmaBlockScalar(dst, a, b, len);
+}
+
+static void fmaScaleBlock(float* dst, float* a, float* b, float scale, int len, int isa)
+{
+#ifdef ISA_HAS_AVX512
+    if (isa == ISA_AVX512)
+        return fmaScaleBlockAVX512(dst, a, b, scale, len);
+#endif
+#ifdef ISA_HAS_AVX2
+    if (isa == ISA_AVX2)
+        return fmaScaleBlockAVX2(dst, a, b, scale, len);
+#endif
+    fmaScaleBlockScalar(dst, a, b, scale, len);
+}
+
+static void fmaLastBlock(double* dst, float* a, float* b, int len, int isa)
+{
+#ifdef ISA_HAS_AVX512
+    if (isa == ISA_AVX512)
+        return fmaLastBlockAVX512(dst, a, b, len);
+#endif
+#ifdef ISA_HAS_AVX2
+    if (isa == ISA_AVX2)
+        return fmaLastBlockAVX2(dst, a, b, len);
+#endif
+    fmaLastBlockScalar(dst, a, b, len);
+}
+
 void DataTableColMajor::initDataTable(Graph* subTempsList, IndexSys* indexer, int subsNum, int colorNum, idxType vertsNum, 
         int thdNum, int useSPMM, int bufMatCols)
 {
@@ -32,6 +205,10 @@ void DataTableColMajor::initDataTable(Graph* subTempsList, IndexSys* indexer, in
     for(int i=0;i<_subsNum;i++)
         _isSubInited[i] = false;
 
+    _isSubLinked = (bool*) malloc (_subsNum*sizeof(bool));
+    for(int i=0;i<_subsNum;i++)
+        _isSubLinked[i] = false;
+
     _tableLen = (int*) malloc (_subsNum*sizeof(int));
     for (int i = 0; i < _subsNum; ++i) {
        _tableLen[i] = _indexer->comb_calc(_colorNum, _subTempsList[i].get_vert_num()); 
@@ -65,94 +242,138 @@ void DataTableColMajor::initSubTempTable(int subsId)
 
     if (_subTempsList[subsId].get_vert_num() > 1 || subsId == _subsNum -1)
     {
+        _dataTable[subsId] = allocTableArray(_tableLen[subsId]);
+        _curTable = _dataTable[subsId];
+        _curSubId = subsId;
 
-
-        int lenCur = _tableLen[subsId];
-        _dataTable[subsId] = (float**)malloc(lenCur*sizeof(float*));
+        _isSubInited[subsId] = true;
+    }
+    else
+    {
+        #ifdef VERBOSE
+           printf("Link to the last subtemplate\n"); 
+           std::fflush(stdout);
+        #endif
+        
+        // point to the last sub-template
+        _dataTable[subsId] = _dataTable[_subsNum - 1];
         _curTable = _dataTable[subsId];
         _curSubId = subsId;
 
-        if (_useSPMM == 0)
-        {
-            // initialize and allocate the memory
+        _isSubInited[subsId] = true;
+    }
+
+    // debug check the total memory usage (GB) 
+    // printf("Vert num: %d, curLen: %d, mem: %f GB\n", _vertsNum, lenCur, ((double)(_vertsNum*lenCur)*4/1024/1024/1024));
+    // std::fflush(stdout);
+
+}
+
+float** DataTableColMajor::allocTableArray(int lenCur)
+{
+    float** table = (float**)malloc(lenCur*sizeof(float*));
+
+    if (_useSPMM == 0)
+    {
+        // initialize and allocate the memory
 #pragma omp parallel for
-            for (int i = 0; i < lenCur; ++i) 
-            {
+        for (int i = 0; i < lenCur; ++i) 
+        {
 
 #ifdef __INTEL_COMPILER
-                _curTable[i] = (float*) _mm_malloc(_vertsNum*sizeof(float), 64); 
+            table[i] = (float*) _mm_malloc(_vertsNum*sizeof(float), 64); 
 #else
-                _curTable[i] = (float*) aligned_alloc(64, _vertsNum*sizeof(float)); 
+            table[i] = (float*) aligned_alloc(64, _vertsNum*sizeof(float)); 
 #endif
 
 #pragma omp parallel for num_threads(omp_get_max_threads())
-                for (int k = 0; k < _vertsNum; ++k) {
-                    _curTable[i][k] = 0;
-                }
-                // std::memset(_curTable[i], 0, _vertsNum*sizeof(float));
+            for (int k = 0; k < _vertsNum; ++k) {
+                table[i][k] = 0;
             }
-
+            // std::memset(table[i], 0, _vertsNum*sizeof(float));
         }
-        else
+
+    }
+    else
+    {
+        // allocate adjacent mem
+        int batchNum = (lenCur + _bufMatCols - 1)/(_bufMatCols);
+        int colStart = 0;
+        for (int i = 0; i < batchNum; ++i) 
         {
-            // allocate adjacent mem
-            int batchNum = (lenCur + _bufMatCols - 1)/(_bufMatCols);
-            int colStart = 0;
-            for (int i = 0; i < batchNum; ++i) 
-            {
-                int batchSize = (i < batchNum -1) ? (_bufMatCols) : (lenCur - _bufMatCols*(batchNum-1));
+            int batchSize = (i < batchNum -1) ? (_bufMatCols) : (lenCur - _bufMatCols*(batchNum-1));
 
 #ifdef __INTEL_COMPILER
-                _curTable[colStart] = (float*)_mm_malloc(_vertsNum*batchSize*sizeof(float), 64); 
+            table[colStart] = (float*)_mm_malloc((int64_t)_vertsNum*batchSize*sizeof(float), 64); 
 #else
-                _curTable[colStart] = (float*)aligned_alloc(64, _vertsNum*batchSize*sizeof(float)); 
+            table[colStart] = (float*)aligned_alloc(64, (int64_t)_vertsNum*batchSize*sizeof(float)); 
 #endif
 
 #pragma omp parallel for num_threads(omp_get_max_threads())
-                for (int k = 0; k < _vertsNum*batchSize; ++k) {
-                    _curTable[colStart][k] = 0;
-                }
-
-                // std::memset(_curTable[colStart], 0, _vertsNum*batchSize*sizeof(float));
+            for (int64_t k = 0; k < (int64_t)_vertsNum*batchSize; ++k) {
+                table[colStart][k] = 0;
+            }
 
-                for (int j = 1; j < batchSize; ++j) {
-                   _curTable[colStart+j] = _curTable[colStart] + j*_vertsNum; 
-                }
+            // std::memset(table[colStart], 0, _vertsNum*batchSize*sizeof(float));
 
-                colStart += batchSize;
+            for (int j = 1; j < batchSize; ++j) {
+               table[colStart+j] = table[colStart] + j*_vertsNum; 
             }
 
-            // for (int i = 1; i < lenCur; ++i) {
-            //    // _curTable[i] = _curTable[0] + i*(int64_t)_vertsNum; 
-            //    _curTable[i] = &((_curTable[0])[i*(int64_t)_vertsNum]); 
-            // }
-            
+            colStart += batchSize;
         }
 
-        _isSubInited[subsId] = true;
+        // for (int i = 1; i < lenCur; ++i) {
+        //    // table[i] = table[0] + i*(int64_t)_vertsNum; 
+        //    table[i] = &((table[0])[i*(int64_t)_vertsNum]); 
+        // }
+        
+    }
+
+    return table;
+}
+
+void DataTableColMajor::freeTableArray(float** table, int lenCur)
+{
+    if (_useSPMM == 0)
+    {
+#pragma omp parallel for 
+        for (int i = 0; i < lenCur; ++i) 
+        {
+            if (table[i] != nullptr)
+            {
+#ifdef __INTEL_COMPILER
+                _mm_free(table[i]);
+#else
+                free(table[i]);
+#endif
+            }
+        }
     }
     else
     {
-        #ifdef VERBOSE
-           printf("Link to the last subtemplate\n"); 
-           std::fflush(stdout);
-        #endif
-        
-        // point to the last sub-template
-        _dataTable[subsId] = _dataTable[_subsNum - 1];
-        _curTable = _dataTable[subsId];
-        _curSubId = subsId;
+        int batchNum = (lenCur + _bufMatCols - 1)/(_bufMatCols);
+        int colStart = 0;
+        for (int i = 0; i < batchNum; ++i) 
+        {
+            int batchSize = (i < batchNum -1) ? (_bufMatCols) : (lenCur - _bufMatCols*(batchNum-1));
+            if (table[colStart] != nullptr) 
+            {
+#ifdef __INTEL_COMPILER
+                _mm_free(table[colStart]);
+#else
+                free(table[colStart]);
+#endif                       
+            }
 
-        _isSubInited[subsId] = true;
-    }
+            colStart += batchSize;
+        }
 
-    // debug check the total memory usage (GB) 
-    // printf("Vert num: %d, curLen: %d, mem: %f GB\n", _vertsNum, lenCur, ((double)(_vertsNum*lenCur)*4/1024/1024/1024));
-    // std::fflush(stdout);
+    }
 
+    free(table);
 }
 
-
 void DataTableColMajor::initSubTempTable(int subsId, int mainId, int auxId)
 {
     if (mainId != DUMMY_VAL && auxId != DUMMY_VAL) {
@@ -179,48 +400,16 @@ void DataTableColMajor::cleanSubTempTable(int subsId, bool isBottom)
 {
     if (_subTempsList[subsId].get_vert_num() > 1 || isBottom == true)
     {
-        if (_dataTable[subsId] != nullptr)
+        if (_isSubLinked[subsId])
         {
-            if (_useSPMM == 0)
-            {
-#pragma omp parallel for 
-                for (int i = 0; i < _tableLen[subsId]; ++i) 
-                {
-                    if (_dataTable[subsId][i] != nullptr)
-                    {
-#ifdef __INTEL_COMPILER
-                        _mm_free(_dataTable[subsId][i]);
-#else
-                        free(_dataTable[subsId][i]);
-#endif
-                    }
-                }
-            }
-            else
-            {
-                int batchNum = (_tableLen[subsId] + _bufMatCols - 1)/(_bufMatCols);
-                int colStart = 0;
-                for (int i = 0; i < batchNum; ++i) 
-                {
-                    int batchSize = (i < batchNum -1) ? (_bufMatCols) : (_tableLen[subsId] - _bufMatCols*(batchNum-1));
-                    if (_dataTable[subsId][colStart] != nullptr) 
-                    {
-#ifdef __INTEL_COMPILER
-                        _mm_free(_dataTable[subsId][colStart]);
-#else
-                        free(_dataTable[subsId][colStart]);
-#endif                       
-                    }
-
-                    colStart += batchSize;
-                }
-
-            }
+            // the table is owned by the caller of linkSubTempTable
+            _dataTable[subsId] = nullptr;
+            _isSubLinked[subsId] = false;
         }
 
         if (_isSubInited[subsId] && _dataTable[subsId] != nullptr) {
 
-            free(_dataTable[subsId]);
+            freeTableArray(_dataTable[subsId], _tableLen[subsId]);
             _dataTable[subsId] = nullptr;
         }
 
@@ -228,6 +417,52 @@ void DataTableColMajor::cleanSubTempTable(int subsId, bool isBottom)
     }
 }
 
+float** DataTableColMajor::detachSubTempTable(int subsId)
+{
+    float** table = _dataTable[subsId];
+
+    _dataTable[subsId] = nullptr;
+    _isSubInited[subsId] = false;
+    _isSubLinked[subsId] = false;
+
+    return table;
+}
+
+void DataTableColMajor::linkSubTempTable(int subsId, float** table)
+{
+    _dataTable[subsId] = table;
+    _isSubInited[subsId] = true;
+    _isSubLinked[subsId] = true;
+}
+
+void DataTableColMajor::copySubTempTable(int subsId, float** table)
+{
+    int lenCur = _tableLen[subsId];
+    _dataTable[subsId] = allocTableArray(lenCur);
+
+    if (_useSPMM == 0)
+    {
+        for (int i = 0; i < lenCur; ++i) {
+            std::memcpy(_dataTable[subsId][i], table[i], _vertsNum*sizeof(float));
+        }
+    }
+    else
+    {
+        // columns of a batch are adjacent
+        int batchNum = (lenCur + _bufMatCols - 1)/(_bufMatCols);
+        int colStart = 0;
+        for (int i = 0; i < batchNum; ++i) 
+        {
+            int batchSize = (i < batchNum -1) ? (_bufMatCols) : (lenCur - _bufMatCols*(batchNum-1));
+            std::memcpy(_dataTable[subsId][colStart], table[colStart], (int64_t)_vertsNum*batchSize*sizeof(float));
+            colStart += batchSize;
+        }
+    }
+
+    _isSubInited[subsId] = true;
+    _isSubLinked[subsId] = false;
+}
+
 void DataTableColMajor::cleanTable()
 {
     for (int i = 0; i < _subsNum-1; ++i) {
@@ -239,6 +474,7 @@ void DataTableColMajor::cleanTable()
 
     free(_dataTable);
     free(_isSubInited);
+    free(_isSubLinked);
     free(_tableLen);
     free(_blockSize);
 
@@ -355,6 +591,9 @@ void DataTableColMajor::arrayWiseFMAScale(float* dst, float* a, float* b, float
         _blockPtrB[i] = _blockPtrB[i-1] + _blockSizeBasic;
     }
 
+    // kernels of the ISA detected at startup
+    int isa = utility::cpuISA();
+
 #pragma omp parallel for schedule(static) num_threads(_thdNum)
     for(int i=0; i<_thdNum; i++)
     {
@@ -364,9 +603,7 @@ void DataTableColMajor::arrayWiseFMAScale(float* dst, float* a, float* b, float
         float* blockPtrBLocal = _blockPtrB[i]; 
         int blockSizeLocal = _blockSize[i];
 
-//#pragma omp simd aligned(dst, a, b: 64)
-        for(int j=0; j<blockSizeLocal;j++)
-            blockPtrDstLocal[j] = blockPtrDstLocal[j] + (blockPtrALocal[j]*(double)blockPtrBLocal[j])*scale;
+        fmaScaleBlock(blockPtrDstLocal, blockPtrALocal, blockPtrBLocal, scale, blockSizeLocal, isa);
     }
 
 }
@@ -383,6 +620,9 @@ void DataTableColMajor::arrayWiseFMALast(double* dst, float* a, float* b)
         _blockPtrB[i] = _blockPtrB[i-1] + _blockSizeBasic;
     }
 
+    // kernels of the ISA detected at startup
+    int isa = utility::cpuISA();
+
 #pragma omp parallel for schedule(static) num_threads(_thdNum)
     for(int i=0; i<_thdNum; i++)
     {
@@ -392,9 +632,7 @@ void DataTableColMajor::arrayWiseFMALast(double* dst, float* a, float* b)
         float* blockPtrBLocal = _blockPtrB[i]; 
         int blockSizeLocal = _blockSize[i];
 
-//#pragma omp simd aligned(dst, a, b: 64)
-        for(int j=0; j<blockSizeLocal;j++)
-            blockPtrDstLocal[j] = blockPtrDstLocal[j] + blockPtrALocal[j]*blockPtrBLocal[j];
+        fmaLastBlock(blockPtrDstLocal, blockPtrALocal, blockPtrBLocal, blockSizeLocal, isa);
     }
 
 }
@@ -411,6 +649,9 @@ void DataTableColMajor::arrayWiseFMAAVX(float* dst, float* a, float* b)
         _blockPtrB[i] = _blockPtrB[i-1] + _blockSizeBasic;
     }
 
+    // kernels of the ISA detected at startup
+    int isa = utility::cpuISA();
+
 #pragma omp parallel for schedule(static) num_threads(_thdNum)
     for(int i=0; i<_thdNum; i++)
     {
@@ -420,81 +661,7 @@ void DataTableColMajor::arrayWiseFMAAVX(float* dst, float* a, float* b)
         float* blockPtrBLocal = _blockPtrB[i]; 
         int blockSizeLocal = _blockSize[i];
 
-#ifdef __AVX512F__ 
-
-    // unrolled by 16 float
-    int n16 = blockSizeLocal & ~(16-1); 
-    __m512 tmpzero = _mm512_set1_ps (0);
-    __mmask16 mask = (1 << (blockSizeLocal - n16)) - 1;
-
-    __m512 vecA;
-    __m512 vecB;
-    __m512 vecC;
-    __m512 vecBuf;
-
-    for (int j = 0; j < n16; j+=16)
-    {
-        vecA = _mm512_load_ps (&(blockPtrALocal[j]));
-        vecB = _mm512_load_ps (&(blockPtrBLocal[j]));
-        vecC = _mm512_load_ps (&(blockPtrDstLocal[j]));
-        vecBuf = _mm512_fmadd_ps(vecA, vecB, vecC);
-        _mm512_store_ps(&(blockPtrDstLocal[j]), vecBuf);
-    }
-
-    if (n16 < blockSizeLocal)
-    {
-        vecA = _mm512_mask_load_ps(tmpzero, mask, &(blockPtrALocal[n16]));
-        vecB = _mm512_mask_load_ps(tmpzero, mask, &(blockPtrBLocal[n16]));
-        vecC = _mm512_mask_load_ps(tmpzero, mask, &(blockPtrDstLocal[n16]));
-        vecBuf = _mm512_fmadd_ps(vecA, vecB, vecC);
-        _mm512_mask_store_ps(&(blockPtrDstLocal[n16]), mask, vecBuf);
-    }
-#else
-
-#ifdef __AVX2__ 
-    // use avx256
-    // unrolled by 8 float
-    int n8 = blockSizeLocal & ~(8-1); 
-
-    int mask_integer[8]={0,0,0,0,0,0,0,0};
-    for (int i=0;i<(blockSizeLocal - n8); i++)
-        mask_integer[i] = -1;
-
-    __m256i mask = _mm256_setr_epi32(mask_integer[0],mask_integer[1],mask_integer[2],mask_integer[3],mask_integer[4],
-                mask_integer[5],mask_integer[6],mask_integer[7]);
-
-    __m256 vecA;
-    __m256 vecB;
-    __m256 vecC;
-    __m256 vecBuf;
-
-    for (int j = 0; j < n8; j+=8)
-    {
-        vecA = _mm256_load_ps (&(blockPtrALocal[j]));
-        vecB = _mm256_load_ps (&(blockPtrBLocal[j]));
-        vecC = _mm256_load_ps (&(blockPtrDstLocal[j]));
-        vecBuf = _mm256_fmadd_ps(vecA, vecB, vecC);
-        _mm256_store_ps(&(blockPtrDstLocal[j]), vecBuf);
-    }
-
-    if (n8 < blockSizeLocal)
-    {
-        vecA = _mm256_maskload_ps(&(blockPtrALocal[n8]), mask);
-        vecB = _mm256_maskload_ps(&(blockPtrBLocal[n8]), mask);
-        vecC = _mm256_maskload_ps(&(blockPtrDstLocal[n8]), mask);
-        vecBuf = _mm256_fmadd_ps(vecA, vecB, vecC);
-        _mm256_maskstore_ps(&(blockPtrDstLocal[n8]), mask, vecBuf);
-    }   
-
-#else
-   // no avx detected 
- //#pragma omp simd aligned(dst, a, b: 64)
-        for(int j=0; j<blockSizeLocal;j++)
-            blockPtrDstLocal[j] = blockPtrDstLocal[j] + blockPtrALocal[j]*blockPtrBLocal[j];          
-#endif
-
-#endif
-
+        fmaBlock(blockPtrDstLocal, blockPtrALocal, blockPtrBLocal, blockSizeLocal, isa);
     }
 
 }
@@ -511,43 +678,7 @@ void DataTableColMajor::arrayWiseFMANaive(float* dst, float* a, float* b)
 
 void DataTableColMajor::arrayWiseFMANaiveAVX(float* dst, float* a, float* b)
 {
-#ifdef __INTEL_COMPILER
-    // unrolled by 16 float
-    int n16 = _vertsNum & ~(16-1); 
-    __m512 tmpzero = _mm512_set1_ps (0);
-    __mmask16 mask = (1 << (_vertsNum - n16)) - 1;
-
-    __m512 vecA;
-    __m512 vecB;
-    __m512 vecC;
-    __m512 vecBuf;
-
-    for (int j = 0; j < n16; j+=16)
-    {
-        vecA = _mm512_load_ps (&(a[j]));
-        vecB = _mm512_load_ps (&(b[j]));
-        vecC = _mm512_load_ps (&(dst[j]));
-        vecBuf = _mm512_fmadd_ps(vecA, vecB, vecC);
-        _mm512_store_ps(&(dst[j]), vecBuf);
-        // vecBuf = _mm512_mul_ps(vecA, vecB);
-        // vecBuf = _mm512_add_ps(vecC, vecBuf);
-    }
-
-    if (n16 < _vertsNum)
-    {
-        vecA = _mm512_mask_load_ps(tmpzero, mask, &(a[n16]));
-        vecB = _mm512_mask_load_ps(tmpzero, mask, &(b[n16]));
-        vecC = _mm512_mask_load_ps(tmpzero, mask, &(dst[n16]));
-        vecBuf = _mm512_fmadd_ps(vecA, vecB, vecC);
-        _mm512_mask_store_ps(&(dst[n16]), mask, vecBuf);
-    }
-
-#else
-//#pragma omp parallel for simd schedule(static) aligned(dst, a, b: 64)
-    for (int i = 0; i < _vertsNum; ++i) {
-        dst[i] = dst[i] + a[i]*b[i]; 
-    }
-#endif
+    fmaBlock(dst, a, b, _vertsNum, utility::cpuISA());
 }
 
 void DataTableColMajor::countCurBottom(int*& idxCToC, int*& colorVals)
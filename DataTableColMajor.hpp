@@ -13,7 +13,7 @@ class DataTableColMajor
     public:
 
         typedef int32_t idxType;
-        DataTableColMajor(): _subTempsList(nullptr), _dataTable(nullptr), 
+        DataTableColMajor(): _subTempsList(nullptr), _isSubLinked(nullptr), _dataTable(nullptr), 
         _tableLen(nullptr), _curTable(nullptr), _curMainTable(nullptr), 
         _curAuxTable(nullptr), _indexer(nullptr), _thdNum(1), _blockSizeBasic(1), _blockSize(nullptr),
         _blockPtrDst(nullptr), _blockPtrDstLast(nullptr), _blockPtrA(nullptr), _blockPtrB(nullptr), _useSPMM(0), _bufMatCols(0) {}
@@ -26,6 +26,16 @@ class DataTableColMajor
         void cleanSubTempTable(int subsId, bool isBottom);
         void cleanTable();
 
+        // share tables between the sub-template chains of several templates
+        // detach: the caller takes over the ownership of the table
+        // link: the table stays owned by the caller, cleanSubTempTable only unlinks it
+        // copy: the sub-template gets its own copy of the table
+        float** detachSubTempTable(int subsId);
+        void linkSubTempTable(int subsId, float** table);
+        void copySubTempTable(int subsId, float** table);
+        float** allocTableArray(int lenCur);
+        void freeTableArray(float** table, int lenCur);
+
         int getMainLen(){ return _curMainLen;}
         int getAuxLen(){ return _curAuxLen; }
         int getTableLen(int subsId) { return _tableLen[subsId]; }
@@ -64,6 +74,7 @@ class DataTableColMajor
         idxType _vertsNum;
         bool _isInited;
         bool* _isSubInited;
+        bool* _isSubLinked;
         int _thdNum;
         // block-wise data copy
         int _blockSizeBasic;
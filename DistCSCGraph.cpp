@@ -0,0 +1,483 @@
+// implementation of the vertex partitioned CSC graph
+
+#include "DistCSCGraph.hpp"
+
+#ifdef DISTRI
+
+#include <stdio.h>
+#include <cstdlib>
+#include <algorithm>
+#include <math.h>
+#include <omp.h>
+#include "Helper.hpp"
+
+DistCSCGraph::~DistCSCGraph()
+{
+    if (_splitsRowIds != nullptr)
+        delete[] _splitsRowIds;
+
+    if (_splitsColIds != nullptr)
+        delete[] _splitsColIds;
+
+    if (_sendBuf != nullptr)
+        free(_sendBuf);
+
+    if (_gridXBuf != nullptr)
+        free(_gridXBuf);
+
+    if (_gridYBuf != nullptr)
+        free(_gridYBuf);
+
+    if (_rowComm != MPI_COMM_NULL)
+        MPI_Comm_free(&_rowComm);
+
+    if (_colComm != MPI_COMM_NULL)
+        MPI_Comm_free(&_colComm);
+}
+
+int DistCSCGraph::getOwner(idxType vertId)
+{
+    return (std::upper_bound(_vertStarts.begin(), _vertStarts.end(), vertId) - _vertStarts.begin()) - 1;
+}
+
+void DistCSCGraph::createFromEdgeListFile(idxType numVerts, offType numEdges,
+        idxType* srcList, idxType* dstList, MPI_Comm comm, bool use2D)
+{/*{{{*/
+
+    double startTime = utility::timer();
+
+    _comm = comm;
+    MPI_Comm_rank(_comm, &_rank);
+    MPI_Comm_size(_comm, &_procNum);
+
+    _numGlobalVertices = numVerts;
+
+    int gridDim = (int)(sqrt((double)_procNum) + 0.5);
+    if (use2D && gridDim*gridDim != _procNum)
+    {
+        if (_rank == 0)
+            fprintf(stderr, "2D partition needs a square number of ranks, use the 1D partition\n");
+
+        use2D = false;
+    }
+
+    if (use2D)
+    {
+        _gridDim = gridDim;
+        partitionGrid(numVerts, numEdges, srcList, dstList);
+    }
+    else
+        partitionRows(numVerts, numEdges, srcList, dstList);
+
+    offType maxNNZ = 0;
+    idxType maxHalo = 0;
+    MPI_Allreduce(&_nnzLocal, &maxNNZ, 1, MPI_INT64_T, MPI_MAX, _comm);
+    MPI_Allreduce(&_numHalo, &maxHalo, 1, MPI_INT, MPI_MAX, _comm);
+
+    if (_rank == 0)
+    {
+        printf("Distributed CSC on %d ranks (%s): local vertices %d, local nnz max %ld, halo rows max %d, partition time %f secs\n",
+                _procNum, (_gridDim > 0) ? "2D" : "1D", _numLocal, (long)maxNNZ, maxHalo, (utility::timer() - startTime));
+        std::fflush(stdout);
+    }
+
+}/*}}}*/
+
+void DistCSCGraph::partitionRows(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList)
+{/*{{{*/
+
+    _vertStarts.resize(_procNum + 1);
+    for (int r = 0; r <= _procNum; ++r) {
+        _vertStarts[r] = (idxType)(((int64_t)r*numVerts)/_procNum);
+    }
+
+    _vertStart = _vertStarts[_rank];
+    _numLocal = _vertStarts[_rank + 1] - _vertStart;
+    _numLocalRows = _numLocal;
+    idxType vertEnd = _vertStarts[_rank + 1];
+
+    // entries of the non-directed adjacency matrix in local rows
+    std::vector<idxType> rowsGlobal;
+    std::vector<idxType> colsGlobal;
+    for (offType i = 0; i < numEdges; ++i)
+    {
+        idxType srcId = srcList[i];
+        idxType dstId = dstList[i];
+
+        if (srcId >= _vertStart && srcId < vertEnd)
+        {
+            rowsGlobal.push_back(srcId);
+            colsGlobal.push_back(dstId);
+        }
+
+        if (dstId >= _vertStart && dstId < vertEnd)
+        {
+            rowsGlobal.push_back(dstId);
+            colsGlobal.push_back(srcId);
+        }
+    }
+
+    _nnzLocal = rowsGlobal.size();
+
+    // remote columns become halo rows, ordered by global id and thus by owner
+    std::vector<idxType> haloGlobal;
+    for (offType i = 0; i < _nnzLocal; ++i) {
+        if (colsGlobal[i] < _vertStart || colsGlobal[i] >= vertEnd)
+            haloGlobal.push_back(colsGlobal[i]);
+    }
+
+    std::sort(haloGlobal.begin(), haloGlobal.end());
+    haloGlobal.erase(std::unique(haloGlobal.begin(), haloGlobal.end()), haloGlobal.end());
+    _numHalo = haloGlobal.size();
+
+    _recvCounts.assign(_procNum, 0);
+    _recvDispls.assign(_procNum, 0);
+    for (idxType i = 0; i < _numHalo; ++i) {
+        _recvCounts[getOwner(haloGlobal[i])]++;
+    }
+
+    for (int r = 1; r < _procNum; ++r) {
+        _recvDispls[r] = _recvDispls[r-1] + _recvCounts[r-1];
+    }
+
+    // ask the owners for the rows required by this rank
+    _sendCounts.assign(_procNum, 0);
+    _sendDispls.assign(_procNum, 0);
+    MPI_Alltoall(&_recvCounts[0], 1, MPI_INT, &_sendCounts[0], 1, MPI_INT, _comm);
+
+    for (int r = 1; r < _procNum; ++r) {
+        _sendDispls[r] = _sendDispls[r-1] + _sendCounts[r-1];
+    }
+
+    _sendRows.resize(_sendDispls[_procNum-1] + _sendCounts[_procNum-1]);
+    MPI_Alltoallv(haloGlobal.data(), &_recvCounts[0], &_recvDispls[0], MPI_INT,
+            _sendRows.data(), &_sendCounts[0], &_sendDispls[0], MPI_INT, _comm);
+
+    for (size_t i = 0; i < _sendRows.size(); ++i) {
+        _sendRows[i] -= _vertStart;
+    }
+
+    // local ids of the entries, sorted by columns as in CSC
+    idxType numCols = _numLocal + _numHalo;
+    std::vector<offType> colPtr(numCols + 1, 0);
+    std::vector<idxType> colsLocal(_nnzLocal);
+
+    for (offType i = 0; i < _nnzLocal; ++i)
+    {
+        idxType colId = colsGlobal[i];
+        if (colId >= _vertStart && colId < vertEnd)
+            colsLocal[i] = colId - _vertStart;
+        else
+            colsLocal[i] = _numLocal + (std::lower_bound(haloGlobal.begin(), haloGlobal.end(), colId) - haloGlobal.begin());
+
+        colPtr[colsLocal[i] + 1]++;
+    }
+
+    for (idxType i = 0; i < numCols; ++i) {
+        colPtr[i+1] += colPtr[i];
+    }
+
+    _entryRows.resize(_nnzLocal);
+    _entryCols.resize(_nnzLocal);
+    for (offType i = 0; i < _nnzLocal; ++i)
+    {
+        offType pos = colPtr[colsLocal[i]]++;
+        _entryRows[pos] = rowsGlobal[i] - _vertStart;
+        _entryCols[pos] = colsLocal[i];
+    }
+
+}/*}}}*/
+
+/**
+ * @brief rank (I,J) of the q x q grid keeps the block A_IJ with 
+ * rows of vertex block I and columns of vertex block J, and owns 
+ * the vertices of the I-th piece of vertex block J
+ *
+ * @param numVerts
+ * @param numEdges
+ * @param srcList
+ * @param dstList
+ */
+void DistCSCGraph::partitionGrid(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList)
+{/*{{{*/
+
+    _gridRow = _rank / _gridDim;
+    _gridCol = _rank % _gridDim;
+
+    MPI_Comm_split(_comm, _gridCol, _gridRow, &_colComm);
+    MPI_Comm_split(_comm, _gridRow, _gridCol, &_rowComm);
+
+    _blockStarts.resize(_gridDim + 1);
+    for (int b = 0; b <= _gridDim; ++b) {
+        _blockStarts[b] = (idxType)(((int64_t)b*numVerts)/_gridDim);
+    }
+
+    idxType rowStart = _blockStarts[_gridRow];
+    idxType rowEnd = _blockStarts[_gridRow + 1];
+    idxType colStart = _blockStarts[_gridCol];
+    idxType colEnd = _blockStarts[_gridCol + 1];
+
+    _colPieceLens.resize(_gridDim);
+    _rowPieceLens.resize(_gridDim);
+    for (int i = 0; i < _gridDim; ++i)
+    {
+        _colPieceLens[i] = (int)(((int64_t)(i+1)*(colEnd - colStart))/_gridDim - ((int64_t)i*(colEnd - colStart))/_gridDim);
+        _rowPieceLens[i] = (int)(((int64_t)(i+1)*(rowEnd - rowStart))/_gridDim - ((int64_t)i*(rowEnd - rowStart))/_gridDim);
+    }
+
+    _vertStart = colStart + (idxType)(((int64_t)_gridRow*(colEnd - colStart))/_gridDim);
+    _numLocal = _colPieceLens[_gridRow];
+    _numLocalRows = rowEnd - rowStart;
+
+    // entries of the non-directed adjacency matrix in block A_IJ
+    std::vector<idxType> rowsLocal;
+    std::vector<idxType> colsLocal;
+    for (offType i = 0; i < numEdges; ++i)
+    {
+        idxType srcId = srcList[i];
+        idxType dstId = dstList[i];
+
+        if (srcId >= rowStart && srcId < rowEnd && dstId >= colStart && dstId < colEnd)
+        {
+            rowsLocal.push_back(srcId - rowStart);
+            colsLocal.push_back(dstId - colStart);
+        }
+
+        if (dstId >= rowStart && dstId < rowEnd && srcId >= colStart && srcId < colEnd)
+        {
+            rowsLocal.push_back(dstId - rowStart);
+            colsLocal.push_back(srcId - colStart);
+        }
+    }
+
+    _nnzLocal = rowsLocal.size();
+
+    // sorted by columns as in CSC
+    std::vector<offType> colPtr(colEnd - colStart + 1, 0);
+    for (offType i = 0; i < _nnzLocal; ++i) {
+        colPtr[colsLocal[i] + 1]++;
+    }
+
+    for (idxType i = 0; i < colEnd - colStart; ++i) {
+        colPtr[i+1] += colPtr[i];
+    }
+
+    _entryRows.resize(_nnzLocal);
+    _entryCols.resize(_nnzLocal);
+    for (offType i = 0; i < _nnzLocal; ++i)
+    {
+        offType pos = colPtr[colsLocal[i]]++;
+        _entryRows[pos] = rowsLocal[i];
+        _entryCols[pos] = colsLocal[i];
+    }
+
+}/*}}}*/
+
+void DistCSCGraph::splitCSC(idxType numsplits)
+{/*{{{*/
+    if (_entryRows.size() != _nnzLocal)
+    {
+        fprintf(stderr, "DistCSCGraph is already split\n");
+        return;
+    }
+
+    _numsplits = numsplits;
+    _splitsRowIds = new std::vector<idxType>[_numsplits];
+    _splitsColIds = new std::vector<idxType>[_numsplits];
+
+    idxType perpiece = std::max(_numLocalRows / _numsplits, 1);
+
+    for (offType j = 0; j < _nnzLocal; ++j)
+    {
+        idxType owner = std::min(_entryRows[j] / perpiece, (_numsplits-1));
+        _splitsColIds[owner].push_back(_entryCols[j]);
+        _splitsRowIds[owner].push_back(_entryRows[j]);
+    }
+
+    // the splits hold all of the entries
+    std::vector<idxType>().swap(_entryRows);
+    std::vector<idxType>().swap(_entryCols);
+
+}/*}}}*/
+
+/**
+ * @brief send the rows of local vertices required by
+ * other ranks, and receive the halo rows of x
+ *
+ * @param x
+ * @param xColNum
+ */
+void DistCSCGraph::exchangeHalo(valType* x, idxType xColNum)
+{
+    startHaloExchange(x, xColNum);
+    waitHaloExchange();
+}
+
+void DistCSCGraph::startHaloExchange(valType* x, idxType xColNum)
+{/*{{{*/
+
+    // no halo rows in the 2D partition
+    if (_gridDim > 0)
+        return;
+
+    int64_t sendLen = (int64_t)_sendRows.size()*xColNum;
+    if (sendLen > _sendBufLen)
+    {
+        if (_sendBuf != nullptr)
+            free(_sendBuf);
+
+        _sendBuf = (valType*) malloc(sendLen*sizeof(valType));
+        _sendBufLen = sendLen;
+    }
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (idxType i = 0; i < _sendRows.size(); ++i) {
+        for (int k = 0; k < xColNum; ++k) {
+            _sendBuf[(int64_t)i*xColNum + k] = x[(int64_t)_sendRows[i]*xColNum + k];
+        }
+    }
+
+    _haloSendCounts.resize(_procNum);
+    _haloSendDispls.resize(_procNum);
+    _haloRecvCounts.resize(_procNum);
+    _haloRecvDispls.resize(_procNum);
+    for (int r = 0; r < _procNum; ++r)
+    {
+        _haloSendCounts[r] = _sendCounts[r]*xColNum;
+        _haloSendDispls[r] = _sendDispls[r]*xColNum;
+        _haloRecvCounts[r] = _recvCounts[r]*xColNum;
+        _haloRecvDispls[r] = _recvDispls[r]*xColNum;
+    }
+
+    MPI_Ialltoallv(_sendBuf, &_haloSendCounts[0], &_haloSendDispls[0], MPI_FLOAT,
+            x + (int64_t)_numLocal*xColNum, &_haloRecvCounts[0], &_haloRecvDispls[0], MPI_FLOAT, _comm, &_haloRequest);
+
+}/*}}}*/
+
+void DistCSCGraph::waitHaloExchange()
+{
+    if (_haloRequest != MPI_REQUEST_NULL)
+        MPI_Wait(&_haloRequest, MPI_STATUS_IGNORE);
+}
+
+// sparse matrix dense matrix (multiple dense vectors) upon the local rows
+void DistCSCGraph::spmmSplit(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+    if (_gridDim > 0)
+    {
+        spmmGrid(x, y, xColNum, numThds);
+        return;
+    }
+
+    exchangeHalo(x, xColNum);
+    spmmLocal(x, y, xColNum, numThds);
+
+}/*}}}*/
+
+/**
+ * @brief SpMM on the 2D partition, x_J is gathered within the 
+ * grid column, the partial A_IJ*x_J are reduced and scattered 
+ * within the grid row, and the pieces are swapped with rank (J,I), 
+ * each step moves O(V/q) rows per rank
+ *
+ * @param x
+ * @param y
+ * @param xColNum
+ * @param numThds
+ */
+void DistCSCGraph::spmmGrid(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+    idxType colBlockLen = _blockStarts[_gridCol + 1] - _blockStarts[_gridCol];
+
+    if (xColNum > _gridBufCols)
+    {
+        if (_gridXBuf != nullptr)
+            free(_gridXBuf);
+
+        if (_gridYBuf != nullptr)
+            free(_gridYBuf);
+
+        _gridXBuf = (valType*) malloc((int64_t)colBlockLen*xColNum*sizeof(valType));
+        _gridYBuf = (valType*) malloc((int64_t)_numLocalRows*xColNum*sizeof(valType));
+        _gridBufCols = xColNum;
+    }
+
+    std::vector<int> counts(_gridDim);
+    std::vector<int> displs(_gridDim, 0);
+
+    // gather x of vertex block J from the grid column
+    for (int i = 0; i < _gridDim; ++i) {
+        counts[i] = _colPieceLens[i]*xColNum;
+        if (i > 0)
+            displs[i] = displs[i-1] + counts[i-1];
+    }
+
+    MPI_Allgatherv(x, _numLocal*xColNum, MPI_FLOAT, _gridXBuf, &counts[0], &displs[0], MPI_FLOAT, _colComm);
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int64_t i = 0; i < (int64_t)_numLocalRows*xColNum; ++i) {
+        _gridYBuf[i] = 0.0;
+    }
+
+    spmmLocal(_gridXBuf, _gridYBuf, xColNum, numThds);
+
+    // sum up the partial y of vertex block I, rank (I,J) gets its J-th piece
+    for (int j = 0; j < _gridDim; ++j) {
+        counts[j] = _rowPieceLens[j]*xColNum;
+    }
+
+    int pieceLen = counts[_gridCol];
+    MPI_Reduce_scatter(MPI_IN_PLACE, _gridYBuf, &counts[0], MPI_FLOAT, MPI_SUM, _rowComm);
+
+    // the J-th piece of block I is owned by rank (J,I), _gridXBuf receives
+    // the I-th piece of block J
+    valType* recvPiece = _gridYBuf;
+    if (_gridRow != _gridCol)
+    {
+        int peer = _gridCol*_gridDim + _gridRow;
+        MPI_Sendrecv(_gridYBuf, pieceLen, MPI_FLOAT, peer, 0, 
+                _gridXBuf, _numLocal*xColNum, MPI_FLOAT, peer, 0, _comm, MPI_STATUS_IGNORE);
+        recvPiece = _gridXBuf;
+    }
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int64_t i = 0; i < (int64_t)_numLocal*xColNum; ++i) {
+        y[i] += recvPiece[i];
+    }
+
+}/*}}}*/
+
+void DistCSCGraph::spmmLocal(valType* x, valType* y, idxType xColNum, idxType numThds)
+{/*{{{*/
+
+#pragma omp parallel for num_threads(numThds)
+    for (idxType s = 0; s < _numsplits; ++s) {
+
+        std::vector<idxType>* localRowIds = &(_splitsRowIds[s]);
+        std::vector<idxType>* localColIds = &(_splitsColIds[s]);
+        offType localSize = localRowIds->size();
+
+        for (offType j = 0; j < localSize; ++j)
+        {
+            valType* readBufPtr = x + (int64_t)(*localColIds)[j]*xColNum;
+            valType* writeBufPtr = y + (int64_t)(*localRowIds)[j]*xColNum;
+
+            // compiler auto vectorization
+            for (int k = 0; k < xColNum; ++k) {
+                writeBufPtr[k] += (readBufPtr[k]);
+            }
+        }
+    }
+
+}/*}}}*/
+
+double DistCSCGraph::allReduceSum(double val)
+{
+    double sum = 0.0;
+    MPI_Allreduce(&val, &sum, 1, MPI_DOUBLE, MPI_SUM, _comm);
+    return sum;
+}
+
+#endif
@@ -0,0 +1,135 @@
+// a vertex (row) partitioned CSC graph for distributed counting
+// each rank keeps the rows of its own vertices, the columns
+// of remote vertices are stored as halo rows of the dense input
+//
+// with a square number of ranks p = q*q, the adjacency matrix 
+// can be partitioned as a q x q checkerboard instead, rank (I,J) 
+// keeps block A_IJ and the I-th piece of vertex block J
+//
+#ifndef DISTCSCGRAPH_H
+#define DISTCSCGRAPH_H
+
+class DistCSCGraph;
+
+#ifdef DISTRI
+
+#include <mpi.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+class DistCSCGraph
+{
+    public:
+
+        typedef int32_t idxType;
+        // edge and nnz counts
+        typedef int64_t offType;
+        typedef float valType;
+
+        DistCSCGraph(): _comm(MPI_COMM_WORLD), _rank(0), _procNum(1), _numGlobalVertices(0), _numLocal(0), _vertStart(0),
+        _numHalo(0), _nnzLocal(0), _numLocalRows(0), _numsplits(0), _splitsRowIds(nullptr), _splitsColIds(nullptr),
+        _sendBuf(nullptr), _sendBufLen(0), _haloRequest(MPI_REQUEST_NULL), _gridDim(0), _gridRow(0), _gridCol(0), _colComm(MPI_COMM_NULL), 
+        _rowComm(MPI_COMM_NULL), _gridXBuf(nullptr), _gridYBuf(nullptr), _gridBufCols(0) {}
+
+        ~DistCSCGraph();
+
+        // keep the edges incident to the vertices owned by this rank,
+        // vertices are assigned to ranks in contiguous blocks, 
+        // use2D falls back to the 1D partition if p is not a square
+        void createFromEdgeListFile(idxType numVerts, offType numEdges,
+                idxType* srcList, idxType* dstList, MPI_Comm comm = MPI_COMM_WORLD, bool use2D = false);
+
+        void splitCSC(idxType numsplits);
+
+        // x holds (local + halo) rows of xColNum columns in row-major,
+        // the halo rows are exchanged before the local SpMM into y
+        void spmmSplit(valType* x, valType* y, idxType xColNum, idxType numThds);
+        void exchangeHalo(valType* x, idxType xColNum);
+
+        // a non-blocking halo exchange of the 1D partition, one at a time, 
+        // overlapped by computation until the wait returns
+        void startHaloExchange(valType* x, idxType xColNum);
+        void waitHaloExchange();
+        bool hasHalo() {return (_gridDim == 0 && _procNum > 1);}
+        // SpMM of the local block on x with exchanged halo rows
+        void spmmLocal(valType* x, valType* y, idxType xColNum, idxType numThds);
+
+        double allReduceSum(double val);
+
+        // accessors, the vertex num is the local one
+        idxType getNumVertices() {return _numLocal;}
+        idxType getNumGlobalVertices() {return _numGlobalVertices;}
+        offType getNNZ() {return _nnzLocal;}
+        idxType getHaloNum() {return _numHalo;}
+        idxType getVertStart() {return _vertStart;}
+        int getRank() {return _rank;}
+        int getProcNum() {return _procNum;}
+        MPI_Comm getComm() {return _comm;}
+
+    private:
+
+        void partitionRows(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList);
+        void partitionGrid(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList);
+        void spmmGrid(valType* x, valType* y, idxType xColNum, idxType numThds);
+        int getOwner(idxType vertId);
+
+        MPI_Comm _comm;
+        int _rank;
+        int _procNum;
+
+        idxType _numGlobalVertices;
+        idxType _numLocal;
+        idxType _vertStart;
+        idxType _numHalo;
+        offType _nnzLocal;
+        // first global vertex of each rank, _procNum + 1 entries
+        std::vector<idxType> _vertStarts;
+
+        // local rows split for threads, columns are local ids
+        // followed by halo ids starting at _numLocal
+        // (in 2D, ids within the row and column blocks)
+        idxType _numLocalRows;
+        idxType _numsplits;
+        std::vector<idxType> _entryRows;
+        std::vector<idxType> _entryCols;
+        std::vector<idxType>* _splitsRowIds;
+        std::vector<idxType>* _splitsColIds;
+
+        // halo exchange plan, counted in rows
+        std::vector<idxType> _sendRows;
+        std::vector<int> _sendCounts;
+        std::vector<int> _sendDispls;
+        std::vector<int> _recvCounts;
+        std::vector<int> _recvDispls;
+        valType* _sendBuf;
+        int64_t _sendBufLen;
+        // the exchange in flight, counted in elements
+        std::vector<int> _haloSendCounts;
+        std::vector<int> _haloSendDispls;
+        std::vector<int> _haloRecvCounts;
+        std::vector<int> _haloRecvDispls;
+        MPI_Request _haloRequest;
+
+        // 2D partition, _gridDim is 0 for the 1D partition
+        int _gridDim;
+        int _gridRow;
+        int _gridCol;
+        // ranks of the same grid column and grid row
+        MPI_Comm _colComm;
+        MPI_Comm _rowComm;
+        // first vertex of each vertex block, _gridDim + 1 entries
+        std::vector<idxType> _blockStarts;
+        // sizes of the pieces of vertex block _gridCol and _gridRow
+        std::vector<int> _colPieceLens;
+        std::vector<int> _rowPieceLens;
+        // x of the column block and partial y of the row block
+        valType* _gridXBuf;
+        valType* _gridYBuf;
+        idxType _gridBufCols;
+};
+
+#endif
+
+#endif
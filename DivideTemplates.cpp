@@ -2,11 +2,16 @@
 
 #include "DivideTemplates.hpp"
 #include <cstring>
+#include <algorithm>
 
 void DivideTemplates::DivideTp(Graph& tp)
 {
     initial();
-    tmp_subtps[0] = tp;
+    if (use_cost_model)
+        choose_root(tp);
+    else
+        tmp_subtps[0] = tp;
+
     cur_index = 1;
 
     parents.push_back(dummy_val);
@@ -130,8 +135,10 @@ void DivideTemplates::split(int& sub, int& root, int& new_main, int& new_aux)
     int* adjs = tmp_subtps[sub].get_adj_list(root);
 
     // choose the first neighbour as the new root
-    // may change this for better performance
+    // or the one of the least modelled cost
     int new_node = adjs[0];
+    if (use_cost_model)
+        new_node = choose_child(sub, root);
 
     // start the split job
     new_main = split_nodes(sub, root, new_node);
@@ -325,3 +332,204 @@ void DivideTemplates::sort_tps()
     }
 
 }/*}}}*/
+
+void DivideTemplates::set_cost_model(int color_num, double spmv_bytes, double fma_bytes)
+{
+    use_cost_model = true;
+    model_colors = color_num;
+    model_spmv_bytes = spmv_bytes;
+    model_fma_bytes = fma_bytes;
+    cost_memo.clear();
+}
+
+/**
+ * @brief root the template at the vertex of the least 
+ * modelled cost, the chosen root is relabeled as vertex 0
+ *
+ * @param tp
+ */
+void DivideTemplates::choose_root(Graph& tp)
+{/*{{{*/
+    int verts = tp.get_vert_num();
+    int root = 0;
+    model_cost = partition_cost(tp.get_canonical_form(0));
+
+    for(int i=1;i<verts;i++)
+    {
+        double cost = partition_cost(tp.get_canonical_form(i));
+        if (cost < model_cost)
+        {
+            model_cost = cost;
+            root = i;
+        }
+    }
+
+#ifdef VERBOSE
+    printf("Template rooted at vertex %d, modelled cost: %f GBytes\n", root, model_cost/(1024*1024*1024)); 
+    std::fflush(stdout);
+#endif    
+
+    if (root == 0)
+    {
+        tmp_subtps[0] = tp;
+        return;
+    }
+
+    // swap the labels of vertex 0 and root
+    vector<int> src_list;
+    vector<int> dst_list;
+    for(int i=0;i<verts;i++)
+    {
+        int* adjs = tp.get_adj_list(i);
+        int deg = tp.get_out_deg(i);
+        for(int j=0;j<deg;j++)
+        {
+            if (i < adjs[j])
+            {
+                src_list.push_back(i == 0 ? root : (i == root ? 0 : i));
+                dst_list.push_back(adjs[j] == 0 ? root : (adjs[j] == root ? 0 : adjs[j]));
+            }
+        }
+    }
+
+    tmp_subtps[0].build_graph(verts, src_list.size(), &src_list[0], &dst_list[0]);
+
+}/*}}}*/
+
+/**
+ * @brief the neighbour of root to be cut off as the aux sub-template
+ *
+ * @param sub
+ * @param root
+ *
+ * @return 
+ */
+int DivideTemplates::choose_child(int sub, int root)
+{/*{{{*/
+    Graph& tp = tmp_subtps[sub];
+    int* adjs = tp.get_adj_list(root);
+    int deg = tp.get_out_deg(root);
+
+    string form = tp.get_canonical_form(root);
+    int sub_size = form_size(form);
+    vector<string> childs;
+    split_forms(form, childs);
+
+    int new_node = adjs[0];
+    double min_cost = 0.0;
+
+    for(int j=0;j<deg;j++)
+    {
+        string aux_form = tp.get_canonical_form(adjs[j], root);
+        double cost = split_cost(sub_size, form_size(aux_form)) 
+            + partition_cost(remove_form(childs, aux_form)) + partition_cost(aux_form);
+
+        if (j == 0 || cost < min_cost)
+        {
+            min_cost = cost;
+            new_node = adjs[j];
+        }
+    }
+
+    return new_node;
+
+}/*}}}*/
+
+/**
+ * @brief least modelled cost of dividing a rooted template 
+ * given by its canonical form, by cutting off one child 
+ * sub-tree of the root at each step
+ *
+ * @param form
+ *
+ * @return 
+ */
+double DivideTemplates::partition_cost(const string& form)
+{/*{{{*/
+    map<string, double>::iterator itr = cost_memo.find(form);
+    if (itr != cost_memo.end())
+        return itr->second;
+
+    vector<string> childs;
+    split_forms(form, childs);
+
+    double min_cost = 0.0;
+    int sub_size = form_size(form);
+
+    for(int i=0;i<childs.size();i++)
+    {
+        // isomorphic children give the same cost
+        if (i > 0 && childs[i] == childs[i-1])
+            continue;
+
+        double cost = split_cost(sub_size, form_size(childs[i])) 
+            + partition_cost(remove_form(childs, childs[i])) + partition_cost(childs[i]);
+
+        if (i == 0 || cost < min_cost)
+            min_cost = cost;
+    }
+
+    cost_memo[form] = min_cost;
+    return min_cost;
+
+}/*}}}*/
+
+double DivideTemplates::split_cost(int sub_size, int aux_size)
+{
+    double cost = comb(model_colors, sub_size)*comb(sub_size, aux_size)*model_fma_bytes;
+    if (aux_size > 1)
+        cost += comb(model_colors, aux_size)*model_spmv_bytes;
+
+    return cost;
+}
+
+/**
+ * @brief the (sorted) canonical forms of the root's children
+ */
+void DivideTemplates::split_forms(const string& form, vector<string>& childs)
+{
+    int depth = 0;
+    int start = 1;
+    for(int i=1;i<form.size()-1;i++)
+    {
+        depth += (form[i] == '(') ? 1 : -1;
+        if (depth == 0)
+        {
+            childs.push_back(form.substr(start, i - start + 1));
+            start = i + 1;
+        }
+    }
+}
+
+/**
+ * @brief the canonical form of the root with one child removed
+ */
+string DivideTemplates::remove_form(vector<string>& childs, const string& child)
+{
+    string form = "(";
+    bool is_removed = false;
+    for(int i=0;i<childs.size();i++)
+    {
+        if (!is_removed && childs[i] == child)
+            is_removed = true;
+        else
+            form += childs[i];
+    }
+
+    form += ")";
+    return form;
+}
+
+int DivideTemplates::form_size(const string& form)
+{
+    return std::count(form.begin(), form.end(), '(');
+}
+
+double DivideTemplates::comb(int n, int k)
+{
+    double val = 1.0;
+    for(int i=1;i<=k;i++)
+        val = val*(n - k + i)/i;
+
+    return val;
+}
@@ -8,6 +8,8 @@
 #include "Graph.hpp"
 #include "Helper.hpp"
 #include <vector>
+#include <map>
+#include <string>
 
 using namespace std;
 
@@ -15,11 +17,18 @@ class DivideTemplates
 {
     public:
 
-        DivideTemplates(): tmp_subtps(nullptr), all_subtps(nullptr), tp_valid(nullptr), dummy_val(93620) {} 
+        DivideTemplates(): tmp_subtps(nullptr), all_subtps(nullptr), tp_valid(nullptr), dummy_val(93620), 
+        use_cost_model(false), model_colors(0), model_spmv_bytes(0), model_fma_bytes(0), model_cost(0) {} 
         ~DivideTemplates() { release(); }
 
         void DivideTp(Graph& tp);
 
+        // choose the root and the cut edges that minimize the modelled bytes, 
+        // spmv_bytes per SpMM column of an aux table and fma_bytes per eMA
+        // of a sub-template table, see CountMat::estimateMemCommPGBSC
+        void set_cost_model(int color_num, double spmv_bytes, double fma_bytes);
+        double get_modelled_cost() {return model_cost;}
+
         void sort_tps();
 
         // accessors
@@ -30,6 +39,8 @@ class DivideTemplates
         int get_main_node_vert_num(int sub) {return all_subtps[node_main[sub]].get_vert_num();}
         int get_aux_node_vert_num(int sub) {return all_subtps[node_aux[sub]].get_vert_num();}
         int get_tp_valid(int sub) {return tp_valid[sub];}
+        // sub-templates are rooted at their vertex 0
+        string get_canonical_form(int sub) {return all_subtps[sub].get_canonical_form(0);}
 
         void release();
 
@@ -44,6 +55,15 @@ class DivideTemplates
         int get_max_val(vector<int>& v1, vector<int>& v2);
 
         void set_nodes(vector<int>& nodes_list, int sub, int node);
+
+        void choose_root(Graph& tp);
+        int choose_child(int sub, int root);
+        double partition_cost(const string& form);
+        double split_cost(int sub_size, int aux_size);
+        void split_forms(const string& form, vector<string>& childs);
+        string remove_form(vector<string>& childs, const string& child);
+        int form_size(const string& form);
+        double comb(int n, int k);
         
 
         Graph* tmp_subtps;
@@ -61,6 +81,14 @@ class DivideTemplates
         int dummy_val;
         // int dummy_val = DUMMY_VAL;
 
+        bool use_cost_model;
+        int model_colors;
+        double model_spmv_bytes;
+        double model_fma_bytes;
+        double model_cost;
+        // modelled cost of the best partition of each rooted sub-template
+        map<string, double> cost_memo;
+
 
 };
 
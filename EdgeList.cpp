@@ -1,6 +1,10 @@
 #include "EdgeList.hpp"
 #include <fstream>
 #include <cstring>
+#include <climits>
+#include <vector>
+#include <algorithm>
+#include "RadixSort.hpp"
 
 using namespace std;
 
@@ -45,16 +49,16 @@ void EdgeList::readfromEdgeList(ifstream& file_strm)
     _numVertices = atoi(line.c_str());
     // get the edge num
     std::getline(file_strm, line);
-    _numEdges = atoi(line.c_str());
+    _numEdges = atol(line.c_str());
 
-    printf("Vert: %d, Edge: %d\n", _numVertices, _numEdges); 
+    printf("Vert: %d, Edge: %ld\n", _numVertices, (long)_numEdges); 
     std::fflush(stdout);
 
     _srcList = new EdgeList::idxType[_numEdges];
     _dstList = new EdgeList::idxType[_numEdges];
 
     EdgeList::idxType max_id = 0;
-    for(EdgeList::idxType j=0;j<_numEdges;j++)
+    for(EdgeList::offType j=0;j<_numEdges;j++)
     {
         std::getline(file_strm, line, ' ');
         _srcList[j] = atoi(line.c_str());
@@ -82,7 +86,7 @@ void EdgeList::readfromEdgeList(ifstream& file_strm)
         }
         // std::memset(v_id, 0, (max_id+1)*sizeof(EdgeList::idxType));
 
-        for(EdgeList::idxType i=0;i<_numEdges;i++)
+        for(EdgeList::offType i=0;i<_numEdges;i++)
         {
             v_id[_srcList[i]] = 1;
             v_id[_dstList[i]] = 1;
@@ -98,7 +102,7 @@ void EdgeList::readfromEdgeList(ifstream& file_strm)
         // debug update the _numVertices
         _numVertices = itr;
 
-        for(EdgeList::idxType i=0;i<_numEdges;i++)
+        for(EdgeList::offType i=0;i<_numEdges;i++)
         {
             _srcList[i] = v_id[_srcList[i]];
             _dstList[i] = v_id[_dstList[i]];
@@ -138,13 +142,13 @@ void EdgeList::readfromMMIO(ifstream& file_strm)
     std::getline(file_strm, line, ' ');
     // get the edge num
     std::getline(file_strm, line);
-    _numEdges = atoi(line.c_str());
+    _numEdges = atol(line.c_str());
 
     _srcList = new EdgeList::idxType[_numEdges];
     _dstList = new EdgeList::idxType[_numEdges];
 
     EdgeList::idxType max_id = 0;
-    for(EdgeList::idxType j=0;j<_numEdges;j++)
+    for(EdgeList::offType j=0;j<_numEdges;j++)
     {
         std::getline(file_strm, line, ' ');
         _srcList[j] = (atoi(line.c_str()) - 1);
@@ -175,7 +179,7 @@ void EdgeList::readfromMMIO(ifstream& file_strm)
         }
         // std::memset(v_id, 0, (max_id+1)*sizeof(EdgeList::idxType));
 
-        for(EdgeList::idxType i=0;i<_numEdges;i++)
+        for(EdgeList::offType i=0;i<_numEdges;i++)
         {
             v_id[_srcList[i]] = 1;
             v_id[_dstList[i]] = 1;
@@ -191,7 +195,7 @@ void EdgeList::readfromMMIO(ifstream& file_strm)
         // debug update the _numVertices
         _numVertices = itr;
 
-        for(EdgeList::idxType i=0;i<_numEdges;i++)
+        for(EdgeList::offType i=0;i<_numEdges;i++)
         {
             _srcList[i] = v_id[_srcList[i]];
             _dstList[i] = v_id[_dstList[i]];
@@ -213,13 +217,13 @@ void EdgeList::readfromfileNoVerticesNum(string fileName)
 
     // get the edge num
     std::getline(file_strm, line);
-    _numEdges = atoi(line.c_str());
+    _numEdges = atol(line.c_str());
 
     _srcList = new EdgeList::idxType[_numEdges];
     _dstList = new EdgeList::idxType[_numEdges];
 
     EdgeList::idxType max_id = 0;
-    for(EdgeList::idxType j=0;j<_numEdges;j++)
+    for(EdgeList::offType j=0;j<_numEdges;j++)
     {
         // std::getline(file_strm, line, ' ');
         std::getline(file_strm, line, '\t');
@@ -240,7 +244,7 @@ void EdgeList::readfromfileNoVerticesNum(string fileName)
     }
     // std::memset(v_id, 0, (max_id+1)*sizeof(EdgeList::idxType));
 
-    for(EdgeList::idxType i=0;i<_numEdges;i++)
+    for(EdgeList::offType i=0;i<_numEdges;i++)
     {
         v_id[_srcList[i]] = 1;
         v_id[_dstList[i]] = 1;
@@ -256,13 +260,13 @@ void EdgeList::readfromfileNoVerticesNum(string fileName)
     // debug update the _numVertices
     _numVertices = itr;
 
-    for(EdgeList::idxType i=0;i<_numEdges;i++)
+    for(EdgeList::offType i=0;i<_numEdges;i++)
     {
         _srcList[i] = v_id[_srcList[i]];
         _dstList[i] = v_id[_dstList[i]];
     }
 #ifdef VERBOSE
-    printf("Finish remove holes vertex num: %d, edge number: %d\n", _numVertices, _numEdges);
+    printf("Finish remove holes vertex num: %d, edge number: %ld\n", _numVertices, (long)_numEdges);
     printf("Start write back file\n");
     std::fflush(stdout);
 #endif
@@ -270,7 +274,7 @@ void EdgeList::readfromfileNoVerticesNum(string fileName)
     txtoutput.open ("rmat.txt");
     txtoutput << _numVertices <<std::endl;
     txtoutput << _numEdges <<std::endl;
-    for(EdgeList::idxType i=0;i<_numEdges;i++)
+    for(EdgeList::offType i=0;i<_numEdges;i++)
     {
         txtoutput<<_srcList[i]<<" "<<_dstList[i]<<std::endl;
     }
@@ -283,10 +287,215 @@ void EdgeList::readfromfileNoVerticesNum(string fileName)
 #ifndef NEC
 void EdgeList::convertToRadixList(pvector<EdgePair<int32_t, int32_t> > &List)
 {
-    for (int i = 0; i < _numEdges; ++i) {
+    for (EdgeList::offType i = 0; i < _numEdges; ++i) {
         List[i].u = _srcList[i];
         List[i].v = _dstList[i];
     }
 }
 #endif
 
+
+// splitmix64, a counter based generator
+static inline uint64_t nextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+bool EdgeList::parseGenerator(string name, int& genType, int& scale, int& edgeFactor, uint64_t& seed)
+{
+    size_t pos = name.find(':');
+    if (pos == string::npos)
+        return false;
+
+    string genName = name.substr(0, pos);
+    if (genName == "uniform")
+        genType = GRAPH_GEN_UNIFORM;
+    else if (genName == "rmat")
+        genType = GRAPH_GEN_RMAT;
+    else if (genName == "kron")
+        genType = GRAPH_GEN_KRON;
+    else
+        return false;
+
+    scale = 0;
+    edgeFactor = 16;
+    seed = 1;
+    unsigned long long seedArg = 1;
+    int fields = sscanf(name.c_str() + pos + 1, "%d:%d:%llu", &scale, &edgeFactor, &seedArg);
+    if (fields < 1)
+        return false;
+
+    seed = seedArg;
+    return true;
+}
+
+bool EdgeList::generate(int genType, int scale, int edgeFactor, uint64_t seed)
+{/*{{{*/
+
+    double startTime = omp_get_wtime();
+
+    int64_t numVerts = ((int64_t)1) << scale;
+    int64_t numEdges = numVerts*edgeFactor;
+    if (scale < 1 || scale > 30 || edgeFactor < 1)
+    {
+        fprintf(stderr, "Synthetic graph of scale %d and edge factor %d does not fit 32-bit vertex ids\n", scale, edgeFactor);
+        return false;
+    }
+
+    _numVertices = (idxType)numVerts;
+    _numEdges = numEdges;
+    _srcList = new EdgeList::idxType[_numEdges];
+    _dstList = new EdgeList::idxType[_numEdges];
+
+    // initiators of R-MAT (Chakrabarti et al.) and of the Graph500 Kronecker generator
+    double a = (genType == GRAPH_GEN_KRON) ? 0.57 : 0.45;
+    double b = (genType == GRAPH_GEN_KRON) ? 0.19 : 0.15;
+    double c = (genType == GRAPH_GEN_KRON) ? 0.19 : 0.15;
+    uint64_t mask = (uint64_t)numVerts - 1;
+    uint64_t seedMix = seed*0xD1B54A32D192ED03ull;
+
+#pragma omp parallel for schedule(static) num_threads(omp_get_max_threads())
+    for (int64_t i = 0; i < numEdges; ++i) 
+    {
+        uint64_t state = seedMix + (uint64_t)i*0x9E3779B97F4A7C15ull;
+        uint64_t u = 0;
+        uint64_t v = 0;
+
+        if (genType == GRAPH_GEN_UNIFORM)
+        {
+            u = nextRandom(state) & mask;
+            v = nextRandom(state) & mask;
+        }
+        else
+        {
+            // one quadrant of the adjacency matrix per level
+            for (int l = 0; l < scale; ++l) 
+            {
+                double r = (nextRandom(state) >> 11)*(1.0/9007199254740992.0);
+                u <<= 1;
+                v <<= 1;
+                if (r < a)
+                    continue;
+                else if (r < a + b)
+                    v |= 1;
+                else if (r < a + b + c)
+                    u |= 1;
+                else
+                {
+                    u |= 1;
+                    v |= 1;
+                }
+            }
+
+            // Graph500 scrambles the vertex ids so that hubs are not 
+            // clustered at the low ids, odd multiplies and xor are 
+            // bijections modulo 2^scale
+            if (genType == GRAPH_GEN_KRON)
+            {
+                u = (((u*0x9E3779B97F4A7C15ull) ^ seedMix)*0xBF58476D1CE4E5B9ull) & mask;
+                v = (((v*0x9E3779B97F4A7C15ull) ^ seedMix)*0xBF58476D1CE4E5B9ull) & mask;
+            }
+        }
+
+        _srcList[i] = (idxType)u;
+        _dstList[i] = (idxType)v;
+    }
+
+    const char* genNames[3] = {"uniform", "R-MAT", "Kronecker"};
+    printf("Generate %s graph of scale %d, edge factor %d: Vert: %d, Edge: %ld using %f secs\n", genNames[genType], 
+            scale, edgeFactor, _numVertices, (long)_numEdges, (omp_get_wtime() - startTime));
+    std::fflush(stdout);
+
+    return true;
+
+}/*}}}*/
+
+void EdgeList::canonicalize(int numThds)
+{/*{{{*/
+
+    double startTime = omp_get_wtime();
+
+    int idBits = 1;
+    while ((((int64_t)1) << idBits) < _numVertices)
+        idBits++;
+
+    int64_t numEdges = _numEdges;
+    uint64_t* keys = new uint64_t[numEdges];
+    uint64_t* buf = new uint64_t[numEdges];
+
+    // keys of the chunk t start at chunkStarts[t]
+    std::vector<int64_t> chunkStarts(numThds + 1, 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (int t = 0; t < numThds; ++t) {
+        int64_t cnt = 0;
+        for (int64_t i = numEdges*t/numThds; i < numEdges*(t+1)/numThds; ++i) 
+            cnt += (_srcList[i] != _dstList[i]) ? 1 : 0;
+
+        chunkStarts[t+1] = cnt;
+    }
+
+    for (int t = 0; t < numThds; ++t) 
+        chunkStarts[t+1] += chunkStarts[t];
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (int t = 0; t < numThds; ++t) {
+        int64_t pos = chunkStarts[t];
+        for (int64_t i = numEdges*t/numThds; i < numEdges*(t+1)/numThds; ++i) 
+        {
+            if (_srcList[i] == _dstList[i])
+                continue;
+
+            uint64_t u = (uint64_t)std::min(_srcList[i], _dstList[i]);
+            uint64_t v = (uint64_t)std::max(_srcList[i], _dstList[i]);
+            keys[pos++] = (u << idBits) | v;
+        }
+    }
+
+    int64_t numKeys = chunkStarts[numThds];
+    radixSort(keys, buf, numKeys, 2*idBits, numThds);
+
+    // the first key of each run of equal keys is kept
+    std::fill(chunkStarts.begin(), chunkStarts.end(), 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (int t = 0; t < numThds; ++t) {
+        int64_t cnt = 0;
+        for (int64_t i = numKeys*t/numThds; i < numKeys*(t+1)/numThds; ++i) 
+            cnt += (i == 0 || keys[i] != keys[i-1]) ? 1 : 0;
+
+        chunkStarts[t+1] = cnt;
+    }
+
+    for (int t = 0; t < numThds; ++t) 
+        chunkStarts[t+1] += chunkStarts[t];
+
+    uint64_t idMask = (((uint64_t)1) << idBits) - 1;
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds)
+    for (int t = 0; t < numThds; ++t) {
+        int64_t pos = chunkStarts[t];
+        for (int64_t i = numKeys*t/numThds; i < numKeys*(t+1)/numThds; ++i) 
+        {
+            if (i > 0 && keys[i] == keys[i-1])
+                continue;
+
+            _srcList[pos] = (idxType)(keys[i] >> idBits);
+            _dstList[pos] = (idxType)(keys[i] & idMask);
+            pos++;
+        }
+    }
+
+    _numEdges = chunkStarts[numThds];
+
+    delete[] keys;
+    delete[] buf;
+
+    printf("Canonical graph: Edge: %ld, removed %ld self loops and %ld duplicated edges using %f secs\n", (long)_numEdges, 
+            (long)(numEdges - numKeys), (long)(numKeys - _numEdges), (omp_get_wtime() - startTime));
+    std::fflush(stdout);
+
+}/*}}}*/
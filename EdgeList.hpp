@@ -8,6 +8,7 @@
 #include <cstring>
 #include <omp.h>
 #include <string>
+#include <stdint.h>
 
 #ifndef NEC
 #include "radix/pvector.h"
@@ -16,11 +17,18 @@
 
 using namespace std;
 
+// synthetic graphs generated in memory
+#define GRAPH_GEN_UNIFORM 0
+#define GRAPH_GEN_RMAT 1
+#define GRAPH_GEN_KRON 2
+
 class EdgeList
 {
     public:
         
         typedef int32_t idxType;
+        // edge counts and edge offsets
+        typedef int64_t offType;
 
         EdgeList(): _numEdges(-1), _numVertices(-1), 
         _srcList(nullptr), _dstList(nullptr){}
@@ -43,11 +51,28 @@ class EdgeList
                 delete[] _dstList;
         }
     
-        idxType getNumEdges() {return _numEdges;}
+        offType getNumEdges() {return _numEdges;}
         idxType getNumVertices() {return _numVertices;}
         idxType* getSrcList() {return _srcList;}
         idxType* getDstList() {return _dstList;}
 
+        void readfromfile(string fileName);
+
+        // a graph of 2^scale vertices and edgeFactor*2^scale edges, each edge 
+        // drawn from its own random stream so the graph does not depend on 
+        // the thread num. Duplicated edges and self loops are kept.
+        // Returns false if the vertex num does not fit idxType
+        bool generate(int genType, int scale, int edgeFactor, uint64_t seed = 1);
+
+        // graph names "uniform:scale:edgefactor[:seed]", "rmat:..." or "kron:..."
+        // select a generator, other names are files
+        static bool parseGenerator(string name, int& genType, int& scale, int& edgeFactor, uint64_t& seed);
+
+        // keep each undirected edge once as (min, max) sorted by src and 
+        // dst, self loops and duplicates (incl. both directions) removed, 
+        // the graph builders add the reversed edges
+        void canonicalize(int numThds);
+
 #ifndef NEC
         // for radix
         void convertToRadixList(pvector<EdgePair<int32_t, int32_t> >& List);
@@ -55,12 +80,11 @@ class EdgeList
         
     private:
 
-        void readfromfile(string fileName);
         void readfromfileNoVerticesNum(string fileName);
         void readfromEdgeList(ifstream& input);
         void readfromMMIO(ifstream& input);
 
-        idxType _numEdges;
+        offType _numEdges;
         idxType _numVertices;
         idxType* _srcList;
         idxType* _dstList;
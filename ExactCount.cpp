@@ -0,0 +1,231 @@
+// implementation of exact template counting
+
+#include "ExactCount.hpp"
+#include "Helper.hpp"
+#include <stdio.h>
+#include <omp.h>
+
+void ExactCount::initialization(CSRGraph* graph, int thd_num)
+{
+    _numVertices = graph->getNumVertices();
+    _offsetBuf.assign(graph->getIndexRow(), graph->getIndexRow() + _numVertices + 1);
+    _indexOffset = _offsetBuf.data();
+    _indexAdj = graph->getIndexCol();
+    _thd_num = thd_num;
+}
+
+void ExactCount::initialization(CSCGraph<int32_t, float>* graph, int thd_num)
+{
+    _numVertices = graph->getNumVertices();
+    _indexOffset = graph->getIndexCol();
+    _indexAdj = graph->getIndexRow();
+    _thd_num = thd_num;
+}
+
+/**
+ * @brief enumerate the embeddings of the template rooted at each
+ * vertex of the graph. Leaves of the same parent and isomorphic 
+ * internal siblings are mapped as unordered sets, and the last 
+ * group of leaves is counted without enumeration
+ *
+ * @param templates
+ * @param calculate_automorphisms
+ *
+ * @return
+ */
+double ExactCount::compute(Graph& templates, bool calculate_automorphisms)
+{/*{{{*/
+
+#ifdef VERBOSE
+    double startTime = utility::timer();
+#endif
+    orderTemplate(templates);
+
+    double embeddings = 0.0;
+
+#pragma omp parallel num_threads(_thd_num) reduction(+:embeddings)
+    {
+        std::vector<idxType> mapped(_tempSize);
+
+#pragma omp for schedule(dynamic, 64)
+        for (idxType v = 0; v < _numVertices; ++v)
+        {
+            mapped[0] = v;
+            embeddings += countEmbeddings(1, &mapped[0]);
+        }
+    }
+
+    embeddings *= _twinFactor;
+    double exactCount = calculate_automorphisms ? embeddings/templates.get_automorphism_num() : embeddings;
+
+#ifdef VERBOSE
+    printf("Exact counting embeddings: %e, time: %f seconds\n", embeddings, (utility::timer() - startTime));
+    std::fflush(stdout);
+#endif
+
+    return exactCount;
+
+}/*}}}*/
+
+void ExactCount::orderTemplate(Graph& templates)
+{/*{{{*/
+
+    _tempSize = templates.get_vert_num();
+    _parentPos.assign(_tempSize, -1);
+    _isLeaf.assign(_tempSize, false);
+    _groupLen.assign(_tempSize, 0);
+    _prevTwin.assign(_tempSize, -1);
+
+    // root at the vertex of the largest degree
+    int root = 0;
+    for (int i = 1; i < _tempSize; ++i) {
+        if (templates.get_out_deg(i) > templates.get_out_deg(root))
+            root = i;
+    }
+
+    std::vector<int> order;
+    std::vector<int> parents(_tempSize, -1);
+    std::vector<int> pos(_tempSize, -1);
+
+    order.push_back(root);
+    pos[root] = 0;
+
+    // BFS over the internal vertices
+    for (int i = 0; i < order.size(); ++i)
+    {
+        int* adjs = templates.get_adj_list(order[i]);
+        for (int j = 0; j < templates.get_out_deg(order[i]); ++j)
+        {
+            int u = adjs[j];
+            if (pos[u] < 0 && templates.get_out_deg(u) > 1)
+            {
+                pos[u] = order.size();
+                parents[u] = order[i];
+                order.push_back(u);
+            }
+        }
+    }
+
+    // leaves grouped by their parents
+    int internalNum = order.size();
+    for (int i = 0; i < internalNum; ++i)
+    {
+        int* adjs = templates.get_adj_list(order[i]);
+        int groupStart = order.size();
+        for (int j = 0; j < templates.get_out_deg(order[i]); ++j)
+        {
+            int u = adjs[j];
+            if (pos[u] < 0)
+            {
+                pos[u] = order.size();
+                parents[u] = order[i];
+                order.push_back(u);
+                _isLeaf[pos[u]] = true;
+            }
+        }
+
+        if (order.size() > groupStart)
+            _groupLen[groupStart] = order.size() - groupStart;
+    }
+
+    for (int i = 1; i < _tempSize; ++i) {
+        _parentPos[i] = pos[parents[order[i]]];
+    }
+
+    // isomorphic internal siblings are mapped in increasing order,
+    // each set of images is counted once for the multiplicity! orders
+    _twinFactor = 1.0;
+    int multiplicity = 1;
+    for (int i = 1; i < internalNum; ++i)
+    {
+        if (_parentPos[i-1] == _parentPos[i] &&
+                templates.get_canonical_form(order[i-1], parents[order[i-1]]) 
+                == templates.get_canonical_form(order[i], parents[order[i]]))
+        {
+            _prevTwin[i] = i-1;
+            _twinFactor *= (++multiplicity);
+        }
+        else
+            multiplicity = 1;
+    }
+
+}/*}}}*/
+
+bool ExactCount::isMapped(idxType v, int pos, idxType* mapped)
+{
+    for (int i = 0; i < pos; ++i) {
+        if (mapped[i] == v)
+            return true;
+    }
+
+    return false;
+}
+
+double ExactCount::countEmbeddings(int pos, idxType* mapped)
+{/*{{{*/
+
+    if (pos == _tempSize)
+        return 1.0;
+
+    idxType parent = mapped[_parentPos[pos]];
+    idxType* adjs = _indexAdj + _indexOffset[parent];
+    idxType deg = _indexOffset[parent+1] - _indexOffset[parent];
+
+    if (_isLeaf[pos])
+    {
+        std::vector<idxType> avail;
+        for (idxType j = 0; j < deg; ++j) {
+            if (!isMapped(adjs[j], pos, mapped))
+                avail.push_back(adjs[j]);
+        }
+
+        int len = _groupLen[pos];
+        if (avail.size() < len)
+            return 0.0;
+
+        // the last group, ordered choices of len out of the available ones
+        if (pos + len == _tempSize)
+        {
+            double count = 1.0;
+            for (int i = 0; i < len; ++i)
+                count *= (double)(avail.size() - i);
+
+            return count;
+        }
+
+        // choose the group as a set, len! orderings of each set
+        double orders = 1.0;
+        for (int i = 2; i <= len; ++i)
+            orders *= i;
+
+        return orders*countLeafGroup(pos, len, 0, 0, avail, mapped);
+    }
+
+    double count = 0.0;
+    for (idxType j = 0; j < deg; ++j)
+    {
+        if (isMapped(adjs[j], pos, mapped) || (_prevTwin[pos] >= 0 && adjs[j] <= mapped[_prevTwin[pos]]))
+            continue;
+
+        mapped[pos] = adjs[j];
+        count += countEmbeddings(pos+1, mapped);
+    }
+
+    return count;
+
+}/*}}}*/
+
+double ExactCount::countLeafGroup(int pos, int len, int start, int depth, std::vector<idxType>& avail, idxType* mapped)
+{
+    if (depth == len)
+        return countEmbeddings(pos + len, mapped);
+
+    double count = 0.0;
+    for (int i = start; i <= (int)avail.size() - (len - depth); ++i)
+    {
+        mapped[pos + depth] = avail[i];
+        count += countLeafGroup(pos, len, i + 1, depth + 1, avail, mapped);
+    }
+
+    return count;
+}
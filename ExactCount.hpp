@@ -0,0 +1,59 @@
+// exact counting of tree templates by enumeration
+// used as the baseline to validate the color-coding
+// estimates on small graphs
+//
+#ifndef EXACTCOUNT_H
+#define EXACTCOUNT_H
+
+#include <stdint.h>
+#include <vector>
+#include "Graph.hpp"
+#include "CSRGraph.hpp"
+#include "CSCGraph.hpp"
+
+using namespace std;
+
+class ExactCount
+{
+    public:
+
+        typedef int32_t idxType;
+        typedef int64_t offType;
+
+        ExactCount(): _numVertices(0), _indexOffset(nullptr), _indexAdj(nullptr), _thd_num(1), _tempSize(0), _twinFactor(1.0) {}
+
+        // the graph is undirected, either storage format gives the adjacency lists
+        void initialization(CSRGraph* graph, int thd_num);
+        void initialization(CSCGraph<int32_t, float>* graph, int thd_num);
+
+        // number of non-induced copies of the template,
+        // or of its embeddings if automorphisms are not corrected
+        double compute(Graph& templates, bool calculate_automorphisms = true);
+
+    private:
+
+        void orderTemplate(Graph& templates);
+        double countEmbeddings(int pos, idxType* mapped);
+        double countLeafGroup(int pos, int len, int start, int depth, std::vector<idxType>& avail, idxType* mapped);
+        bool isMapped(idxType v, int pos, idxType* mapped);
+
+        idxType _numVertices;
+        offType* _indexOffset;
+        idxType* _indexAdj;
+        // 64-bit copy of the 32-bit offsets of a CSRGraph
+        std::vector<offType> _offsetBuf;
+        int _thd_num;
+
+        // template vertices, internal ones in BFS order followed by
+        // the leaves grouped by their parents
+        int _tempSize;
+        std::vector<int> _parentPos;
+        std::vector<bool> _isLeaf;
+        // number of leaves in the group starting at each leaf position
+        std::vector<int> _groupLen;
+        // previous isomorphic sibling of an internal position, -1 if none
+        std::vector<int> _prevTwin;
+        double _twinFactor;
+};
+
+#endif
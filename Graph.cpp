@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <cstring>
+#include <algorithm>
 
 
 using namespace std;
@@ -139,6 +140,8 @@ Graph& Graph::operator= (const Graph& obj)
 
     std::memcpy(adj_list, obj.get_adj_list(), edge_num*sizeof(int));
     std::memcpy(deg_list, obj.get_deg_list(), (vert_num+1)*sizeof(unsigned));
+
+    return *this;
 }
 
 void Graph::serialize(ofstream& output)
@@ -169,6 +172,134 @@ void Graph::deserialize(ifstream& input)
    
 }
 
+string Graph::get_canonical_form(int root, int parent)
+{
+    return canonical_form(root, parent);
+}
+
+/**
+ * @brief AHU encoding of the sub-tree below vert,
+ * children encodings are sorted so that the result 
+ * does not depend on the vertex labeling
+ *
+ * @param vert
+ * @param parent
+ *
+ * @return 
+ */
+string Graph::canonical_form(int vert, int parent)
+{/*{{{*/
+    vector<string> child_forms;
+    int* adjs = get_adj_list(vert);
+    int deg = get_out_deg(vert);
+
+    for(int j=0;j<deg;j++)
+    {
+        if (adjs[j] != parent)
+            child_forms.push_back(canonical_form(adjs[j], vert));
+    }
+
+    std::sort(child_forms.begin(), child_forms.end());
+
+    string form = "(";
+    for(int j=0;j<child_forms.size();j++)
+        form += child_forms[j];
+
+    form += ")";
+    return form;
+}/*}}}*/
+
+/**
+ * @brief automorphisms of a tree, the tree is rooted at its 
+ * center, or at its central edge when it has two centers 
+ *
+ * @return 
+ */
+double Graph::get_automorphism_num()
+{/*{{{*/
+    if (vert_num <= 1)
+        return 1.0;
+
+    // peel off the leaves layer by layer to find the centers
+    vector<int> degs(vert_num);
+    vector<int> leaves;
+    for(int i=0;i<vert_num;i++)
+    {
+        degs[i] = get_out_deg(i);
+        if (degs[i] <= 1)
+            leaves.push_back(i);
+    }
+
+    int rest = vert_num;
+    while (rest > 2)
+    {
+        rest -= leaves.size();
+        vector<int> next_leaves;
+        for(int i=0;i<leaves.size();i++)
+        {
+            int* adjs = get_adj_list(leaves[i]);
+            for(int j=0;j<get_out_deg(leaves[i]);j++)
+            {
+                if (--degs[adjs[j]] == 1)
+                    next_leaves.push_back(adjs[j]);
+            }
+        }
+        leaves = next_leaves;
+    }
+
+    if (leaves.size() == 1)
+        return rooted_automorphism_num(leaves[0], -1);
+
+    // two centers, the central edge may be flipped
+    int c1 = leaves[0];
+    int c2 = leaves[1];
+    double num = rooted_automorphism_num(c1, c2)*rooted_automorphism_num(c2, c1);
+    if (canonical_form(c1, c2) == canonical_form(c2, c1))
+        num *= 2;
+
+    return num;
+
+}/*}}}*/
+
+/**
+ * @brief automorphisms of the sub-tree below vert fixing vert, 
+ * product of the children's automorphisms and of the factorials 
+ * of the multiplicities of isomorphic children
+ *
+ * @param vert
+ * @param parent
+ *
+ * @return 
+ */
+double Graph::rooted_automorphism_num(int vert, int parent)
+{/*{{{*/
+    vector<string> child_forms;
+    double num = 1.0;
+    int* adjs = get_adj_list(vert);
+    int deg = get_out_deg(vert);
+
+    for(int j=0;j<deg;j++)
+    {
+        if (adjs[j] != parent)
+        {
+            child_forms.push_back(canonical_form(adjs[j], vert));
+            num *= rooted_automorphism_num(adjs[j], vert);
+        }
+    }
+
+    std::sort(child_forms.begin(), child_forms.end());
+
+    int multiplicity = 1;
+    for(int j=1;j<child_forms.size();j++)
+    {
+        multiplicity = (child_forms[j] == child_forms[j-1]) ? multiplicity + 1 : 1;
+        num *= multiplicity;
+    }
+
+    return num;
+
+}/*}}}*/
+
 void Graph::release()
 {
     if (adj_list != NULL)
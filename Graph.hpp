@@ -5,6 +5,7 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -47,11 +48,23 @@ class Graph {
         int* get_adj_list() const {return adj_list;}
         int* get_adj_list(int vert) {return &adj_list[deg_list[vert]];}
 
+        // canonical (AHU) encoding of the tree rooted at root
+        // isomorphic rooted trees share the same encoding
+        // a parent vertex excludes its side of the tree
+        string get_canonical_form(int root, int parent = -1);
+
+        // number of automorphisms of the tree, 
+        // counted upon the canonical forms rooted at its center
+        double get_automorphism_num();
+
         // release the memory of adj_list and deg_list
         void release();
 
     private:
 
+        string canonical_form(int vert, int parent);
+        double rooted_automorphism_num(int vert, int parent);
+
         int vert_num;
         unsigned edge_file;
         unsigned edge_num;
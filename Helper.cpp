@@ -1,4 +1,6 @@
 #include "Helper.hpp"
+#include <cstdlib>
+#include <cstring>
 
 double utility::timer() {
 
@@ -9,3 +11,48 @@ double utility::timer() {
 }
 
 
+static int detectISA() {
+
+    int isa = ISA_SCALAR;
+#ifdef ISA_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        isa = ISA_AVX512;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        isa = ISA_AVX2;
+#else
+#if defined(__AVX512F__)
+    isa = ISA_AVX512;
+#elif defined(__AVX2__)
+    isa = ISA_AVX2;
+#endif
+#endif
+
+    const char* env = getenv("SC_ISA");
+    if (env != NULL)
+    {
+        if (strcmp(env, "scalar") == 0)
+            isa = ISA_SCALAR;
+        else if (strcmp(env, "avx2") == 0 && isa > ISA_AVX2)
+            isa = ISA_AVX2;
+    }
+
+    return isa;
+}
+
+int utility::cpuISA() {
+
+    static const int isa = detectISA();
+    return isa;
+
+}
+
+const char* utility::isaName(int isa) {
+
+    if (isa == ISA_AVX512)
+        return "AVX512";
+    if (isa == ISA_AVX2)
+        return "AVX2";
+    return "scalar";
+
+}
@@ -6,10 +6,46 @@
 
 #define DUMMY_VAL 93620
 
+// the adjacency matrices are unweighted, the CSR value array is only 
+// kept for the libraries of the non-NEC build (MKL, SpMP, SpDM3)
+#if defined(NEC) && !defined(PATTERN_ONLY)
+#define PATTERN_ONLY
+#endif
+
+// instruction sets of the SpMM and FMA kernels
+#define ISA_SCALAR 0
+#define ISA_AVX2 1
+#define ISA_AVX512 2
+
+// gcc and clang on x86 compile every kernel with a target attribute and 
+// pick one at runtime, other compilers (icc, ncc) keep the one of their flags
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__INTEL_COMPILER) && (defined(__x86_64__) || defined(__i386__))
+#define ISA_DISPATCH
+#define ISA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define ISA_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define ISA_TARGET_AVX2
+#define ISA_TARGET_AVX512
+#endif
+
+// kernels of an ISA are built if it is dispatched at runtime or enabled by the flags
+#if defined(ISA_DISPATCH) || defined(__AVX2__)
+#define ISA_HAS_AVX2
+#endif
+#if defined(ISA_DISPATCH) || defined(__AVX512F__)
+#define ISA_HAS_AVX512
+#endif
+
 namespace utility {
 
     double timer();
 
+    // best ISA of the cpu, detected by cpuid on the first call, 
+    // env SC_ISA=scalar|avx2|avx512 lowers it (for testing)
+    int cpuISA();
+
+    const char* isaName(int isa);
+
     // double timer() {
     //
     //     struct timeval tp;
@@ -0,0 +1,80 @@
+// parallel LSD radix sort of unsigned integer keys, used to
+// canonicalize the edge list and to sort the adjacency segments
+//
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+
+// bits of a digit, one histogram of 2^RADIX_DIGIT_BITS buckets per chunk
+#define RADIX_DIGIT_BITS 8
+
+/**
+ * @brief stable sort of the n keys by their low keyBits bits, the keys are
+ * split into numThds contiguous chunks, each pass counts the digits of every
+ * chunk and scatters the chunk to its own offsets (no atomics).
+ * buf holds n keys, the sorted keys end in keys. With numThds 1 no 
+ * parallel region is opened, to sort segments inside a parallel loop
+ *
+ * @tparam keyType
+ * @param keys
+ * @param buf
+ * @param n
+ * @param keyBits
+ * @param numThds
+ */
+template<class keyType>
+void radixSort(keyType* keys, keyType* buf, int64_t n, int keyBits, int numThds)
+{/*{{{*/
+
+    const int radix = 1 << RADIX_DIGIT_BITS;
+    const keyType digitMask = radix - 1;
+
+    if (n < 2)
+        return;
+
+    std::vector<int64_t> hist((int64_t)numThds*radix);
+    keyType* src = keys;
+    keyType* dst = buf;
+
+    for (int shift = 0; shift < keyBits; shift += RADIX_DIGIT_BITS)
+    {
+        std::fill(hist.begin(), hist.end(), 0);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds) if(numThds > 1)
+        for (int t = 0; t < numThds; ++t) {
+            int64_t* localHist = hist.data() + (int64_t)t*radix;
+            for (int64_t i = n*t/numThds; i < n*(t+1)/numThds; ++i)
+                localHist[(src[i] >> shift) & digitMask]++;
+        }
+
+        // offsets by digit, then by chunk to keep the sort stable
+        int64_t offset = 0;
+        for (int d = 0; d < radix; ++d) {
+            for (int t = 0; t < numThds; ++t) {
+                int64_t cnt = hist[(int64_t)t*radix + d];
+                hist[(int64_t)t*radix + d] = offset;
+                offset += cnt;
+            }
+        }
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThds) if(numThds > 1)
+        for (int t = 0; t < numThds; ++t) {
+            int64_t* localHist = hist.data() + (int64_t)t*radix;
+            for (int64_t i = n*t/numThds; i < n*(t+1)/numThds; ++i)
+                dst[localHist[(src[i] >> shift) & digitMask]++] = src[i];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != keys)
+        std::memcpy(keys, src, n*sizeof(keyType));
+
+}/*}}}*/
+
+#endif
@@ -0,0 +1,320 @@
+// implementation of the vertex reordering methods
+
+#include "Reordering.hpp"
+#include "Helper.hpp"
+#include <cstdio>
+#include <math.h>
+#include <algorithm>
+#include <omp.h>
+
+const char* Reordering::getName(int method)
+{
+    switch (method)
+    {
+        case REORDER_RCM: return "RCM";
+        case REORDER_DEGREE: return "degree";
+        case REORDER_HUB: return "hub";
+        case REORDER_GORDER: return "Gorder";
+        default: return "none";
+    }
+}
+
+void Reordering::compute(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList,
+        int method, idxType* perm)
+{/*{{{*/
+
+    double startTime = utility::timer();
+
+    _numVertices = numVerts;
+    buildAdjacency(numEdges, srcList, dstList);
+
+    std::vector<idxType> order;
+    order.reserve(_numVertices);
+
+    if (method == REORDER_RCM)
+        orderRCM(order);
+    else if (method == REORDER_DEGREE)
+        orderDegree(order);
+    else if (method == REORDER_HUB)
+        orderHub(order);
+    else if (method == REORDER_GORDER)
+        orderGorder(order);
+    else
+    {
+        for (idxType i = 0; i < _numVertices; ++i)
+            order.push_back(i);
+    }
+
+    for (idxType i = 0; i < _numVertices; ++i) {
+        perm[order[i]] = i;
+    }
+
+    std::vector<offType>().swap(_offset);
+    std::vector<idxType>().swap(_adj);
+
+    printf("Reordering %s using %f secs\n", getName(method), (utility::timer() - startTime));
+    std::fflush(stdout);
+
+}/*}}}*/
+
+void Reordering::apply(offType numEdges, idxType* srcList, idxType* dstList, idxType* perm)
+{
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (offType i = 0; i < numEdges; ++i) {
+        srcList[i] = perm[srcList[i]];
+        dstList[i] = perm[dstList[i]];
+    }
+}
+
+void Reordering::buildAdjacency(offType numEdges, idxType* srcList, idxType* dstList)
+{/*{{{*/
+
+    _offset.assign(_numVertices + 1, 0);
+    for (offType i = 0; i < numEdges; ++i) {
+        _offset[srcList[i] + 1]++;
+        _offset[dstList[i] + 1]++;
+    }
+
+    for (idxType i = 0; i < _numVertices; ++i) {
+        _offset[i+1] += _offset[i];
+    }
+
+    _adj.resize(_offset[_numVertices]);
+    std::vector<offType> pos(_offset.begin(), _offset.end() - 1);
+    for (offType i = 0; i < numEdges; ++i) {
+        _adj[pos[srcList[i]]++] = dstList[i];
+        _adj[pos[dstList[i]]++] = srcList[i];
+    }
+
+}/*}}}*/
+
+// bfs from root, returns the eccentricity of root, 
+// the levels of visitList are reset by the caller
+Reordering::idxType Reordering::bfsLevels(idxType root, std::vector<idxType>& level, std::vector<idxType>& visitList)
+{
+    visitList.clear();
+    visitList.push_back(root);
+    level[root] = 0;
+
+    idxType maxLevel = 0;
+    for (idxType i = 0; i < visitList.size(); ++i)
+    {
+        idxType v = visitList[i];
+        for (offType j = _offset[v]; j < _offset[v+1]; ++j)
+        {
+            idxType u = _adj[j];
+            if (level[u] < 0)
+            {
+                level[u] = level[v] + 1;
+                maxLevel = std::max(maxLevel, level[u]);
+                visitList.push_back(u);
+            }
+        }
+    }
+
+    return maxLevel;
+}
+
+/**
+ * @brief Reverse Cuthill-McKee, each connected component starts
+ * from a pseudo-peripheral vertex and neighbours are visited by
+ * increasing degrees
+ *
+ * @param order
+ */
+void Reordering::orderRCM(std::vector<idxType>& order)
+{/*{{{*/
+
+    std::vector<idxType> level(_numVertices, -1);
+    std::vector<bool> isNumbered(_numVertices, false);
+    std::vector<idxType> visitList;
+    std::vector<idxType> neighbors;
+
+    // the components are started from low degree vertices
+    std::vector<idxType> byDegree(_numVertices);
+    for (idxType i = 0; i < _numVertices; ++i)
+        byDegree[i] = i;
+
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+            [this](idxType a, idxType b) {return getDeg(a) < getDeg(b);});
+
+    for (idxType s = 0; s < _numVertices; ++s)
+    {
+        idxType root = byDegree[s];
+        if (isNumbered[root])
+            continue;
+
+        // a few sweeps to the min degree vertex of the last level
+        idxType ecc = bfsLevels(root, level, visitList);
+        for (int sweep = 0; sweep < 2; ++sweep)
+        {
+            // visitList is in bfs order, the tail is the last level
+            idxType farthest = visitList.back();
+            for (idxType i = visitList.size() - 1; i >= 0 && level[visitList[i]] == ecc; --i) {
+                if (getDeg(visitList[i]) < getDeg(farthest))
+                    farthest = visitList[i];
+            }
+
+            for (idxType i = 0; i < visitList.size(); ++i)
+                level[visitList[i]] = -1;
+
+            idxType eccFar = bfsLevels(farthest, level, visitList);
+            if (eccFar <= ecc)
+                break;
+
+            root = farthest;
+            ecc = eccFar;
+        }
+
+        for (idxType i = 0; i < visitList.size(); ++i)
+            level[visitList[i]] = -1;
+
+        // Cuthill-McKee numbering of the component
+        idxType head = order.size();
+        order.push_back(root);
+        isNumbered[root] = true;
+        for (idxType i = head; i < order.size(); ++i)
+        {
+            idxType v = order[i];
+            neighbors.clear();
+            for (offType j = _offset[v]; j < _offset[v+1]; ++j)
+            {
+                idxType u = _adj[j];
+                if (!isNumbered[u])
+                {
+                    isNumbered[u] = true;
+                    neighbors.push_back(u);
+                }
+            }
+
+            std::sort(neighbors.begin(), neighbors.end(),
+                    [this](idxType a, idxType b) {return getDeg(a) < getDeg(b);});
+            order.insert(order.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+
+}/*}}}*/
+
+void Reordering::orderDegree(std::vector<idxType>& order)
+{
+    for (idxType i = 0; i < _numVertices; ++i)
+        order.push_back(i);
+
+    std::stable_sort(order.begin(), order.end(),
+            [this](idxType a, idxType b) {return getDeg(a) > getDeg(b);});
+}
+
+// vertices above the average degree are clustered at the front,
+// both groups keep their original relative order
+void Reordering::orderHub(std::vector<idxType>& order)
+{
+    double avgDeg = (_numVertices > 0) ? (double)_offset[_numVertices]/_numVertices : 0.0;
+
+    for (idxType i = 0; i < _numVertices; ++i) {
+        if (getDeg(i) > avgDeg)
+            order.push_back(i);
+    }
+
+    for (idxType i = 0; i < _numVertices; ++i) {
+        if (getDeg(i) <= avgDeg)
+            order.push_back(i);
+    }
+}
+
+/**
+ * @brief a greedy Gorder-like ordering, the next vertex maximizes
+ * the number of neighbours and common neighbours among the last
+ * _gorderWindow placed vertices. Scores are kept in a unit heap of
+ * score buckets, common neighbours through hubs above sqrt(|V|)
+ * are skipped
+ *
+ * @param order
+ */
+void Reordering::orderGorder(std::vector<idxType>& order)
+{/*{{{*/
+
+    idxType hubDeg = (idxType)sqrt((double)_numVertices);
+
+    std::vector<idxType> score(_numVertices, 0);
+    std::vector<bool> isPlaced(_numVertices, false);
+
+    // doubly linked lists of the vertices of each score
+    std::vector<idxType> prev(_numVertices, -1);
+    std::vector<idxType> next(_numVertices, -1);
+    std::vector<idxType> head(1, -1);
+    idxType top = 0;
+
+    auto unlink = [&](idxType v) {
+        if (prev[v] >= 0)
+            next[prev[v]] = next[v];
+        else
+            head[score[v]] = next[v];
+
+        if (next[v] >= 0)
+            prev[next[v]] = prev[v];
+    };
+
+    auto link = [&](idxType v) {
+        if (score[v] >= head.size())
+            head.resize(score[v] + 1, -1);
+
+        prev[v] = -1;
+        next[v] = head[score[v]];
+        if (head[score[v]] >= 0)
+            prev[head[score[v]]] = v;
+
+        head[score[v]] = v;
+        top = std::max(top, score[v]);
+    };
+
+    auto update = [&](idxType v, idxType delta) {
+        if (isPlaced[v])
+            return;
+
+        unlink(v);
+        score[v] += delta;
+        link(v);
+    };
+
+    // placing or retiring v from the window changes the scores around it
+    auto updateAround = [&](idxType v, idxType delta) {
+        for (offType j = _offset[v]; j < _offset[v+1]; ++j)
+        {
+            idxType u = _adj[j];
+            update(u, delta);
+
+            if (getDeg(u) > hubDeg)
+                continue;
+
+            for (offType k = _offset[u]; k < _offset[u+1]; ++k) {
+                if (_adj[k] != v)
+                    update(_adj[k], delta);
+            }
+        }
+    };
+
+    // the zero score bucket starts in the order of decreasing degrees
+    std::vector<idxType> byDegree;
+    orderDegree(byDegree);
+    for (idxType i = _numVertices - 1; i >= 0; --i) {
+        link(byDegree[i]);
+    }
+
+    while (order.size() < _numVertices)
+    {
+        while (head[top] < 0)
+            top--;
+
+        idxType v = head[top];
+        unlink(v);
+        isPlaced[v] = true;
+        order.push_back(v);
+
+        updateAround(v, 1);
+        if (order.size() > _gorderWindow)
+            updateAround(order[order.size() - 1 - _gorderWindow], -1);
+    }
+
+}/*}}}*/
@@ -0,0 +1,58 @@
+// vertex reordering of the input graph, applied to the edge
+// list before the CSC (or CSR) graph is built, to improve the
+// locality of the gathers in SpMM
+//
+#ifndef REORDERING_H
+#define REORDERING_H
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+#define REORDER_NONE 0
+#define REORDER_RCM 1
+#define REORDER_DEGREE 2
+#define REORDER_HUB 3
+#define REORDER_GORDER 4
+
+class Reordering
+{
+    public:
+
+        typedef int32_t idxType;
+        typedef int64_t offType;
+
+        Reordering(): _numVertices(0), _gorderWindow(5) {}
+
+        // perm[oldId] = newId
+        void compute(idxType numVerts, offType numEdges, idxType* srcList, idxType* dstList,
+                int method, idxType* perm);
+
+        // relabel the edge list in place
+        static void apply(offType numEdges, idxType* srcList, idxType* dstList, idxType* perm);
+
+        static const char* getName(int method);
+
+    private:
+
+        void buildAdjacency(offType numEdges, idxType* srcList, idxType* dstList);
+        idxType getDeg(idxType v) {return _offset[v+1] - _offset[v];}
+
+        // each fills the new order of the vertices
+        void orderRCM(std::vector<idxType>& order);
+        void orderDegree(std::vector<idxType>& order);
+        void orderHub(std::vector<idxType>& order);
+        void orderGorder(std::vector<idxType>& order);
+
+        idxType bfsLevels(idxType root, std::vector<idxType>& level, std::vector<idxType>& visitList);
+
+        idxType _numVertices;
+        // non-directed adjacency lists
+        std::vector<offType> _offset;
+        std::vector<idxType> _adj;
+        // vertices placed before the current one that count in the Gorder score
+        int _gorderWindow;
+};
+
+#endif
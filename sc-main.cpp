@@ -19,8 +19,14 @@
 #include "CSRGraph.hpp"
 #include "CSCGraph.hpp"
 #include "CountMat.hpp"
+#include "ExactCount.hpp"
 #include "Helper.hpp"
 #include "EdgeList.hpp"
+#include "Reordering.hpp"
+#ifdef DISTRI
+#include <mpi.h>
+#include "DistCSCGraph.hpp"
+#endif
 
 // for testing pb radix
 #ifndef NEC 
@@ -329,6 +335,18 @@ void benchmarkSpMVNaiveFull(int argc, char** argv, EdgeList& elist, int numCols,
     printf("Naive SpMVFull Tht: %f GFLOP/sec\n", flopsTotal*numCols/timeElapsed);
     std::fflush(stdout);           
 
+    // the nnz-balanced kernel used in counting
+    double mergeElapsed = 0.0;
+    for (int j = 0; j < numCols; ++j) {
+        startTime = utility::timer();
+        csrnaiveG.SpMVMergePath(xMat+j*csrnaiveG.getNumVertices(), 
+                yMat+j*csrnaiveG.getNumVertices(), comp_thds);
+        mergeElapsed += (utility::timer() - startTime);
+    }
+
+    printf("Merge-path SpMV using %f secs, speedup over naive %f\n", mergeElapsed/numCols, timeElapsed/mergeElapsed);
+    std::fflush(stdout);           
+
     // check yMat
     for (int i = 0; i < 10; ++i) {
         printf("Elem: %d is: %f\n", i, yMat[i]); 
@@ -506,6 +524,65 @@ void benchmarkCSCSplitMM(int argc, char** argv, EdgeList& elist, int numCols, in
 
 #endif
 
+/**
+ * @brief average time of a CSC SpMM of numCols columns by one of the
+ * SPMM_ kernels, used to report the effect of reordering the input graph
+ *
+ * @param elist
+ * @param numCols
+ * @param comp_thds
+ * @param benchItr
+ * @param backend
+ *
+ * @return 
+ */
+double timeCSCSpMM(EdgeList& elist, int numCols, int comp_thds, int benchItr, int backend)
+{/*{{{*/
+
+    CSCGraph<int32_t, float> cscG;
+    cscG.createFromEdgeListFile(elist.getNumVertices(), elist.getNumEdges(), elist.getSrcList(), elist.getDstList());
+    cscG.splitCSC(4*comp_thds);
+
+    int64_t testLen = (int64_t)cscG.getNumVertices()*numCols;
+    float* xMat = (float*) malloc(testLen*sizeof(float));
+    float* yMat = (float*) malloc(testLen*sizeof(float));
+
+#pragma omp parallel for num_threads(omp_get_max_threads())
+    for (int64_t i = 0; i < testLen; ++i) {
+        xMat[i] = 2.0; 
+        yMat[i] = 0.0; 
+    }
+
+    // warm up, builds the layout of the kernel
+    cscG.spmm(xMat, yMat, numCols, comp_thds, backend);
+
+    double timeElapsed = 0.0;
+    for (int i = 0; i < benchItr; ++i) {
+        double startTime = utility::timer();
+        cscG.spmm(xMat, yMat, numCols, comp_thds, backend);
+        timeElapsed += (utility::timer() - startTime);
+    }
+
+    free(xMat);
+    free(yMat);
+
+    return timeElapsed/benchItr;
+
+}/*}}}*/
+
+// compare the SpMM kernels of the CSC graph to CSC-Split
+void benchmarkCSCBackends(EdgeList& elist, int numCols, int comp_thds, int benchItr)
+{
+    const char* names[5] = {"CSC-Split", "Propagation blocking", "Tiled", "Compressed", "Pull"};
+    double splitTime = timeCSCSpMM(elist, numCols, comp_thds, benchItr, SPMM_SPLIT);
+
+    for (int b = SPMM_SPLIT; b <= SPMM_PULL; ++b) {
+        double t = (b == SPMM_SPLIT) ? splitTime : timeCSCSpMM(elist, numCols, comp_thds, benchItr, b);
+        printf("%s SpMM of %d cols using %f secs, speedup over CSC-Split %f\n", names[b], numCols, t, splitTime/t);
+        std::fflush(stdout);
+    }
+}
+
 #ifndef NEC
 // Inspector-Executor interface in MKL 11.3+
 // NOTICE: the way to invoke the mkl 11.3 inspector-executor
@@ -867,7 +944,7 @@ void benchmarkEMA(int argc, char** argv, EdgeList& elist, int numCols, int comp_
     printf("Start benchmarking eMA\n");
     std::fflush(stdout);           
 
-    printf("Input EdgeList: vert: %d, Edges: %d\n", elist.getNumVertices(), elist.getNumEdges());
+    printf("Input EdgeList: vert: %d, Edges: %ld\n", elist.getNumVertices(), (long)elist.getNumEdges());
     std::fflush(stdout);           
 
     double startTime = 0.0;
@@ -1556,6 +1633,24 @@ void benchmarkSpMPFull(int argc, char** argv, EdgeList& elist, int numCols, int
 int main(int argc, char** argv)
 {
    
+    // the process reporting results
+    bool isRoot = true;
+
+#ifdef DISTRI
+    // only the master thread calls MPI
+    int mpiThdLevel = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &mpiThdLevel);
+    int mpiRank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+
+    // results are reported by rank 0
+    if (mpiRank > 0)
+    {
+        freopen("/dev/null", "w", stdout);
+        isRoot = false;
+    }
+#endif
+
     int load_binary = 0;
     int write_binary = 0;
     string graph_name;
@@ -1564,9 +1659,22 @@ int main(int argc, char** argv)
     int comp_thds;
     int isPruned = 1;
     int vtuneStart = -1;
-    // bool calculate_automorphism = true;
-    bool calculate_automorphism = false;
+    // bool calculate_automorphism = false;
+    bool calculate_automorphism = true;
     int benchItr = 1;
+    // compare the estimates to exact counts (small graphs only)
+    int validateExact = 0;
+    // 0: single process, 1: vertices partitioned by blocks of rows, 
+    // 2: iterations split over processes holding the whole graph,
+    // 3: adjacency matrix partitioned as a 2D checkerboard (needs DISTRI)
+    int distMode = 0;
+    // consume the SpMM outputs by batches in the eMA
+    int useStream = 1;
+    // relabel the vertices of a text input, see Reordering.hpp
+    int reorderMode = REORDER_NONE;
+    // SpMM kernel of the CSC graph, 0: CSC-Split, 1: propagation blocking, 2: tiled, 
+    // 3: compressed adjacency, 4: pull, 5: push or pull timed per batch width
+    int spmmBackend = SPMM_SPLIT;
 
     int useSPMM = 1;
     // bool useMKL = true;
@@ -1602,12 +1710,37 @@ int main(int argc, char** argv)
     if (argc > 10)
         benchItr = atoi(argv[10]);
 
+    if (argc > 11)
+        validateExact = atoi(argv[11]);
+
+    if (argc > 12)
+        distMode = atoi(argv[12]);
+
+    if (argc > 13)
+        useStream = atoi(argv[13]);
+
+    if (argc > 14)
+        reorderMode = atoi(argv[14]);
+
+    if (argc > 15)
+        spmmBackend = atoi(argv[15]);
+
+#ifndef DISTRI
+    if (distMode != 0)
+    {
+        fprintf(stderr, "Distributed counting requires a build with DISTRI, use a single process\n");
+        distMode = 0;
+    }
+#endif
+
     // end of arguments
     benchmarkEMANEC(argc, argv, 10, comp_thds, benchItr);
 
-    // SPMM in CSR uses MKL
+    // SPMM in CSR uses MKL, or the native merge-path kernel without MKL
+#ifndef NEC
     if (useSPMM && (!useCSC))
         useMKL = true;
+#endif
 
     if (useCSC)
     {
@@ -1624,29 +1757,39 @@ int main(int argc, char** argv)
         printf("Use SPMM Impl\n");
         std::fflush(stdout);          
     }
-#ifdef __AVX512F__
-    printf("AVX512 available\n");
-    std::fflush(stdout);          
-#else
-#ifdef __AVX2__
-    printf("AVX2 available\n");
-    std::fflush(stdout);                 
-#else
-    printf("No avx available\n");
-    std::fflush(stdout);                 
-#endif
 #endif
+
+    // detect the ISA of this node at startup, its kernels are used from here on
+    utility::cpuISA();
+#ifdef VERBOSE 
+    printf("Kernel ISA: %s\n", utility::isaName(utility::cpuISA()));
+    std::fflush(stdout);          
 #endif
 
     CSRGraph* csrInputG = nullptr;
     CSCGraph<int32_t, float>* cscInputG = nullptr;
+#ifdef DISTRI
+    DistCSCGraph* distInputG = nullptr;
+#endif
+
+    // the graph is partitioned across processes
+    bool isPartitioned = (distMode == 1 || distMode == 3);
 
-    if (!useCSC)
+    if (isPartitioned)
+    {
+        // each rank reads the text edge list and keeps its own rows
+        if (load_binary || write_binary)
+        {
+            fprintf(stderr, "Binary graph files are not supported by distributed counting\n");
+            load_binary = 0;
+            write_binary = 0;
+        }
+    }
+    else if (!useCSC)
         csrInputG = new CSRGraph();
     else
         cscInputG = new CSCGraph<int32_t, float>();
         
-    Graph input_template;
     double startTime = utility::timer();
 
     // read in graph file and make 
@@ -1673,7 +1816,12 @@ int main(int argc, char** argv)
             csrInputG->deserialize(input_file, useMKL, useRcm);
         else
         {
-            cscInputG->deserialize(input_file);
+            if (!cscInputG->deserialize(input_file))
+            {
+                close(input_file);
+                return 1;
+            }
+
             cscInputG->splitCSC(4*comp_thds);
         }
 
@@ -1689,10 +1837,50 @@ int main(int argc, char** argv)
         // the io work is here
         double iotStart = utility::timer();
 
-        EdgeList elist(graph_name); 
+        // a graph name like rmat:scale:edgefactor is generated in memory
+        EdgeList elist; 
+        int genType = 0;
+        int genScale = 0;
+        int genEdgeFactor = 0;
+        uint64_t genSeed = 1;
+        if (EdgeList::parseGenerator(graph_name, genType, genScale, genEdgeFactor, genSeed))
+        {
+            if (!elist.generate(genType, genScale, genEdgeFactor, genSeed))
+                return 1;
+        }
+        else
+            elist.readfromfile(graph_name);
 
         std::cout<<"Disk Load Text Data using " << (utility::timer() - iotStart) << " s" << std::endl;
 
+        // count on the simple undirected graph
+        elist.canonicalize(comp_thds);
+
+        // the CSR storage and the MKL kernels keep 32-bit offsets
+        if (csrInputG != nullptr && 2*elist.getNumEdges() > INT32_MAX)
+        {
+            fprintf(stderr, "%ld edges exceed the 32-bit offsets of CSR, use the CSC graph\n", (long)elist.getNumEdges());
+            return 1;
+        }
+
+        // relabel the edge list before building the graph
+        int32_t* perm = nullptr;
+        if (reorderMode != REORDER_NONE)
+        {
+            const int reorderCols = 16;
+            double spmmOrig = timeCSCSpMM(elist, reorderCols, comp_thds, benchItr, spmmBackend);
+
+            perm = (int32_t*) malloc(elist.getNumVertices()*sizeof(int32_t));
+            Reordering reorder;
+            reorder.compute(elist.getNumVertices(), elist.getNumEdges(), elist.getSrcList(), elist.getDstList(), reorderMode, perm);
+            Reordering::apply(elist.getNumEdges(), elist.getSrcList(), elist.getDstList(), perm);
+
+            double spmmReorder = timeCSCSpMM(elist, reorderCols, comp_thds, benchItr, spmmBackend);
+            printf("SpMM of %d cols before %s reordering %f secs, after %f secs, speedup %f\n", 
+                    reorderCols, Reordering::getName(reorderMode), spmmOrig, spmmReorder, spmmOrig/spmmReorder);
+            std::fflush(stdout);
+        }
+
         if (isBenchmark)
         {
 
@@ -1739,6 +1927,9 @@ int main(int argc, char** argv)
             // benchmarking CSC-Split MM
             // benchmarkCSCSplitMM(argc, argv, elist, numCols, comp_thds, benchItr);
 
+            // benchmarking the SpMM kernels of CSC against CSC-Split
+            // benchmarkCSCBackends(elist, numCols, comp_thds, benchItr);
+
             // benchmarking eMA 
             // benchmarkEMA(argc, argv, elist, numCols, comp_thds, benchItr);
             
@@ -1755,17 +1946,34 @@ int main(int argc, char** argv)
         else
         {
 
+#ifdef DISTRI
+            if (isPartitioned)
+            {
+                distInputG = new DistCSCGraph();
+                distInputG->createFromEdgeListFile(elist.getNumVertices(), elist.getNumEdges(), elist.getSrcList(), elist.getDstList(), 
+                        MPI_COMM_WORLD, (distMode == 3));
+                distInputG->splitCSC(4*comp_thds);
+            }
+            else
+#endif
             if (csrInputG != nullptr)
                 csrInputG->createFromEdgeListFile(elist.getNumVertices(), elist.getNumEdges(), elist.getSrcList(), elist.getDstList(), useMKL, useRcm, false);
             else
             {
                 cscInputG->createFromEdgeListFile(elist.getNumVertices(), elist.getNumEdges(), elist.getSrcList(), elist.getDstList(), false);
                 cscInputG->splitCSC(4*comp_thds);
+
+                // stored with the binary format
+                if (perm != nullptr)
+                    cscInputG->setPermutation(perm);
             }
         }
+
+        if (perm != nullptr)
+            free(perm);
     }
 
-    if (write_binary)
+    if (write_binary && isRoot)
     {
         // save graph into binary file, graph is a data structure
         ofstream output_file("graph.data", ios::binary);
@@ -1781,18 +1989,86 @@ int main(int argc, char** argv)
         output_file.close();
     }
 
+    // the compressed kernels do not need the raw rows, which are 
+    // kept for the exact validation
+    if (cscInputG != nullptr && spmmBackend == SPMM_COMPRESSED)
+        cscInputG->compressAdjacency(!validateExact);
+
     printf("Prepare Datasets using %f secs\n", (utility::timer() - startTime));
     std::fflush(stdout);           
     
     // ---------------- start of computing ----------------
-    // load input templates
-    input_template.read_enlist(template_name);
+    // load input templates, a comma separated list of templates 
+    // of the same size are counted on shared colorings
+    std::vector<string> template_files;
+    size_t nameStart = 0;
+    size_t nameEnd = 0;
+    while ((nameEnd = template_name.find(',', nameStart)) != string::npos)
+    {
+        template_files.push_back(template_name.substr(nameStart, nameEnd - nameStart));
+        nameStart = nameEnd + 1;
+    }
+    template_files.push_back(template_name.substr(nameStart));
+
+    int template_num = template_files.size();
+    Graph* input_templates = new Graph[template_num];
+    for (int i = 0; i < template_num; ++i) {
+        input_templates[i].read_enlist(template_files[i]);
+    }
+
+    double* template_counts = new double[template_num];
 
     // start CSR mat computing
     CountMat executor;
+#ifdef DISTRI
+    if (distInputG != nullptr)
+        executor.initialization(distInputG, comp_thds, iterations, vtuneStart, calculate_automorphism);
+    else
+#endif
     executor.initialization(csrInputG, cscInputG, comp_thds, iterations, isPruned, useSPMM, vtuneStart, calculate_automorphism);
 
-    executor.compute(input_template, isEstimate);
+#ifdef DISTRI
+    if (distMode == 2)
+        executor.setIterationComm(MPI_COMM_WORLD);
+#endif
+
+    executor.setStreaming(useStream);
+    executor.setSpMMBackend(spmmBackend);
+
+    executor.compute(input_templates, template_num, template_counts, isEstimate);
+
+    if (template_num > 1 && !isEstimate)
+    {
+        for (int i = 0; i < template_num; ++i) {
+            printf("Template %s final count is %e\n", template_files[i].c_str(), template_counts[i]);
+        }
+        std::fflush(stdout);
+    }
+
+    // validation mode, relative errors of the estimates to the exact counts
+    if (validateExact && isPartitioned)
+    {
+        fprintf(stderr, "Exact counting needs the whole graph, skipped in distributed counting\n");
+    }
+    else if (validateExact && !isEstimate && isRoot)
+    {
+        ExactCount exactCounter;
+        if (csrInputG != nullptr)
+            exactCounter.initialization(csrInputG, comp_thds);
+        else
+            exactCounter.initialization(cscInputG, comp_thds);
+
+        for (int i = 0; i < template_num; ++i) 
+        {
+            double exactStart = utility::timer();
+            double exactCount = exactCounter.compute(input_templates[i], calculate_automorphism);
+            double relError = (exactCount > 0) ? fabs(template_counts[i] - exactCount)/exactCount : 0.0;
+
+            printf("Template %s exact count is %e, estimate relative error: %f, exact counting time: %f seconds\n", 
+                    template_files[i].c_str(), exactCount, relError, (utility::timer() - exactStart));
+        }
+        std::fflush(stdout);
+    }
 
     if (csrInputG != nullptr)
         delete csrInputG;
@@ -1800,6 +2076,16 @@ int main(int argc, char** argv)
     if (cscInputG != nullptr)
         delete cscInputG;
 
+    delete[] template_counts;
+    delete[] input_templates;
+
+#ifdef DISTRI
+    if (distInputG != nullptr)
+        delete distInputG;
+
+    MPI_Finalize();
+#endif
+
     return 0;
 
 }